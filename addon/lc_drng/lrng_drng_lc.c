@@ -61,14 +61,15 @@ static int lrng_lc_drng_generate_helper(void *drng, u8 *outbuf,
 	return outbuflen;
 }
 
-static void *lrng_lc_drng_alloc(u32 sec_strength)
+static void *lrng_lc_drng_alloc(u32 sec_strength, int node)
 {
 	struct lrng_drng_info *lrng_drng_info;
 	struct lc_rng_ctx *lc_ctx_local;
 	u32 time = random_get_entropy();
 	int ret;
 
-	lrng_drng_info = kzalloc(sizeof(*lrng_drng_info), GFP_KERNEL);
+	lrng_drng_info = kzalloc_node(sizeof(*lrng_drng_info), GFP_KERNEL,
+				      node);
 	if (!lrng_drng_info)
 		return ERR_PTR(-ENOMEM);
 
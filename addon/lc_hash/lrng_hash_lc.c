@@ -59,7 +59,7 @@ static void lrng_lc_hash_desc_zero(struct shash_desc *shash)
 	lc_hash_zero(sha3);
 }
 
-static void *lrng_lc_hash_alloc(void)
+static void *lrng_lc_hash_alloc(int node)
 {
 	/* This only works with larger SHA-3 implementations */
 	BUILD_BUG_ON(LC_SHA3_512_CTX_SIZE > HASH_MAX_DESCSIZE);
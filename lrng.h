@@ -15,7 +15,9 @@
  * struct lrng_drng_cb - cryptographic callback functions defining a DRNG
  * @drng_name		Name of DRNG
  * @drng_alloc:		Allocate DRNG -- the provided integer should be used for
- *			sanity checks.
+ *			sanity checks. The DRNG state should be allocated on
+ *			the provided NUMA node which is NUMA_NO_NODE if the
+ *			DRNG is not bound to a node.
  *			return: allocated data structure or PTR_ERR on error
  * @drng_dealloc:	Deallocate DRNG
  * @drng_seed:		Seed the DRNG with data of arbitrary length drng: is
@@ -23,20 +25,28 @@
  *			return: >= 0 on success, < 0 on error
  * @drng_generate:	Generate random numbers from the DRNG with arbitrary
  *			length
+ * @drng_max_reqsize:	Maximum number of bytes the DRNG can generate with one
+ *			drng_generate call -- 0 if the DRNG has no limit
+ * @drng_chunksize:	Preferred number of bytes to generate with one
+ *			drng_generate call while holding the DRNG lock -- 0 to
+ *			use the LRNG default
  */
 struct lrng_drng_cb {
 	const char *(*drng_name)(void);
-	void *(*drng_alloc)(u32 sec_strength);
+	void *(*drng_alloc)(u32 sec_strength, int node);
 	void (*drng_dealloc)(void *drng);
 	int (*drng_seed)(void *drng, const u8 *inbuf, u32 inbuflen);
 	int (*drng_generate)(void *drng, u8 *outbuf, u32 outbuflen);
+	u32 drng_max_reqsize;
+	u32 drng_chunksize;
 };
 
 /*
  * struct lrng_hash_cb - cryptographic callback functions defining a hash
  * @hash_name		Name of Hash used for reading entropy pool arbitrary
  *			length
- * @hash_alloc:		Allocate the hash for reading the entropy pool
+ * @hash_alloc:		Allocate the hash for reading the entropy pool on the
+ *			provided NUMA node (NUMA_NO_NODE if not bound to a node)
  *			return: allocated data structure (NULL is success too)
  *				or ERR_PTR on error
  * @hash_dealloc:	Deallocate Hash
@@ -66,7 +76,7 @@ struct lrng_drng_cb {
  */
 struct lrng_hash_cb {
 	const char *(*hash_name)(void);
-	void *(*hash_alloc)(void);
+	void *(*hash_alloc)(int node);
 	void (*hash_dealloc)(void *hash);
 	u32 (*hash_digestsize)(void *hash);
 	int (*hash_init)(struct shash_desc *shash, void *hash);
@@ -32,12 +32,23 @@
 
 /*
  * SP800-90A defines a maximum request size of 1<<16 bytes. The given value is
- * considered a safer margin.
+ * considered a safer margin. It applies to DRNGs which do not declare their
+ * preferred request size with struct lrng_drng_cb.
  *
  * This value is allowed to be changed.
  */
 #define LRNG_DRNG_MAX_REQSIZE		(1<<12)
 
+/*
+ * Maximum number of bytes a DRNG which also serves atomic callers generates
+ * with one generate operation for a sleeping caller, see
+ * CONFIG_LRNG_DRNG_NODE_ATOMIC. This operation is performed with interrupts
+ * disabled to protect the DRNG state against the atomic callers.
+ *
+ * This value is allowed to be changed.
+ */
+#define LRNG_DRNG_ATOMIC_REQSIZE	(1<<9)
+
 /*
  * SP800-90A defines a maximum number of requests between reseeds of 2^48.
  * The given value is considered a much safer margin, balancing requests for
@@ -48,6 +59,49 @@
  */
 #define LRNG_DRNG_RESEED_THRESH		(1<<20)
 
+/*
+ * Number of DRNG requests a CPU accounts locally before updating the shared
+ * request counter of the DRNG. A CPU takes a batch of requests from the
+ * shared counter at once which implies that the reseed threshold is reached
+ * at the latest after LRNG_DRNG_RESEED_THRESH requests and at the earliest
+ * after LRNG_DRNG_RESEED_THRESH - (number of CPUs * LRNG_DRNG_REQUESTS_BATCH)
+ * requests.
+ *
+ * This value is allowed to be changed but MUST NOT be larger than
+ * LRNG_DRNG_RESEED_THRESH.
+ */
+#define LRNG_DRNG_REQUESTS_BATCH	(1<<6)
+
+/*
+ * Time in seconds after which a time-based reseed of a fully seeded DRNG is
+ * attempted again when the entropy sources did not deliver any entropy for the
+ * scheduled reseed. The retry is not performed later than the regular reseed.
+ *
+ * This value is allowed to be changed.
+ */
+#define LRNG_DRNG_RESEED_RETRY_TIME	10
+
+/*
+ * Maximum number of passes of the emergency seeding collecting entropy for a
+ * DRNG that is not fully seeded, and the maximum time in milliseconds to wait
+ * for new entropy between two passes.
+ *
+ * These values are allowed to be changed.
+ */
+#define LRNG_DRNG_EMERGENCY_SEED_PASSES		8
+#define LRNG_DRNG_EMERGENCY_SEED_MAX_WAIT_MS	100
+
+/*
+ * Default weights of the DRNG instances for the allocation of entropy with
+ * CONFIG_LRNG_DRNG_ES_FAIR_SHARE. A DRNG with twice the weight of another DRNG
+ * may consume twice the entropy from the entropy sources before it has to
+ * leave the entropy to the other DRNG when that DRNG is starved.
+ *
+ * These values are allowed to be changed but MUST NOT be zero.
+ */
+#define LRNG_DRNG_ES_WEIGHT		4
+#define LRNG_DRNG_ES_WEIGHT_PR		1
+
 /*
  * Maximum DRNG generation operations without reseed having full entropy
  * This value defines the absolute maximum value of DRNG generation operations
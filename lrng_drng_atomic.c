@@ -10,6 +10,7 @@
 #include <linux/lrng.h>
 
 #include "lrng_drng_atomic.h"
+#include "lrng_drng_atomic_percpu.h"
 #include "lrng_drng_chacha20.h"
 #include "lrng_es_aux.h"
 #include "lrng_es_mgr.h"
@@ -26,6 +27,11 @@ static struct chacha20_state chacha20_atomic = {
  *
  * The reason for having this is due to the fact that DRNGs other than
  * the ChaCha20 DRNG may sleep.
+ *
+ * Atomic callers are served by the per-CPU atomic DRNG, if enabled, or by the
+ * DRNG of the local NUMA node if it uses the ChaCha20 DRNG as well. This DRNG
+ * is the fallback when those DRNGs are not fully seeded or wait for their
+ * reseed.
  */
 static struct lrng_drng lrng_drng_atomic = {
 	LRNG_DRNG_STATE_INIT(lrng_drng_atomic,
@@ -48,16 +54,12 @@ void lrng_drng_atomic_reset(void)
 	spin_unlock_irqrestore(&lrng_drng_atomic.spin_lock, flags);
 }
 
-void lrng_drng_atomic_force_reseed(void)
-{
-	lrng_drng_atomic.force_reseed = lrng_drng_atomic.fully_seeded;
-}
-
 static bool lrng_drng_atomic_must_reseed(struct lrng_drng *drng)
 {
 	return (!drng->fully_seeded ||
-		atomic_read(&lrng_drng_atomic.requests) == 0 ||
+		atomic_read(&lrng_drng_atomic.requests) <= 0 ||
 		drng->force_reseed ||
+		lrng_drng_epoch_stale(drng) ||
 		time_after(jiffies,
 			   drng->last_seeded + lrng_drng_reseed_max_time * HZ));
 }
@@ -66,6 +68,7 @@ void lrng_drng_atomic_seed_drng(struct lrng_drng *regular_drng)
 {
 	u8 seedbuf[LRNG_DRNG_SECURITY_STRENGTH_BYTES]
 						__aligned(LRNG_KCAPI_ALIGN);
+	u32 epoch;
 	int ret;
 
 	if (!lrng_drng_atomic_must_reseed(&lrng_drng_atomic))
@@ -73,11 +76,14 @@ void lrng_drng_atomic_seed_drng(struct lrng_drng *regular_drng)
 
 	/*
 	 * Reseed atomic DRNG another DRNG "regular" while this regular DRNG
-	 * is reseeded. Therefore, this code operates in non-atomic context and
-	 * thus can use the lrng_drng_get function to get random numbers from
-	 * the just freshly seeded DRNG.
+	 * is reseeded. Therefore, this code operates in non-atomic context.
+	 * As the caller holds the seeding lock of the just freshly seeded
+	 * DRNG, the random numbers are obtained without reseeding it which
+	 * would wait for the seeding lock if a reseed of all DRNGs was forced
+	 * in the meantime.
 	 */
-	ret = lrng_drng_get(regular_drng, seedbuf, sizeof(seedbuf));
+	ret = lrng_drng_get_noreseed(regular_drng, seedbuf, sizeof(seedbuf),
+				     &epoch);
 
 	if (ret < 0) {
 		pr_warn("Error generating random numbers for atomic DRNG: %d\n",
@@ -88,6 +94,7 @@ void lrng_drng_atomic_seed_drng(struct lrng_drng *regular_drng)
 		spin_lock_irqsave(&lrng_drng_atomic.spin_lock, flags);
 		lrng_drng_inject(&lrng_drng_atomic, seedbuf, ret,
 				 regular_drng->fully_seeded, "atomic");
+		WRITE_ONCE(lrng_drng_atomic.seed_epoch, epoch);
 		spin_unlock_irqrestore(&lrng_drng_atomic.spin_lock, flags);
 	}
 	memzero_explicit(&seedbuf, sizeof(seedbuf));
@@ -107,11 +114,21 @@ static void lrng_drng_atomic_get(u8 *outbuf, u32 outbuflen)
 		u32 todo = min_t(u32, outbuflen, LRNG_DRNG_MAX_REQSIZE);
 		int ret;
 
-		atomic_dec(&drng->requests);
+		/*
+		 * Prefer the per-CPU DRNG and the DRNG of the local NUMA node
+		 * to spread the load.
+		 */
+		ret = lrng_drng_atomic_percpu_get(outbuf, todo);
+		if (ret <= 0)
+			ret = lrng_drng_node_get_atomic(outbuf, todo);
+		if (ret <= 0) {
+			lrng_drng_requests_dec(drng);
 
-		spin_lock_irqsave(&drng->spin_lock, flags);
-		ret = drng->drng_cb->drng_generate(drng->drng, outbuf, todo);
-		spin_unlock_irqrestore(&drng->spin_lock, flags);
+			spin_lock_irqsave(&drng->spin_lock, flags);
+			ret = drng->drng_cb->drng_generate(drng->drng, outbuf,
+							   todo);
+			spin_unlock_irqrestore(&drng->spin_lock, flags);
+		}
 		if (ret <= 0) {
 			pr_warn("getting random data from DRNG failed (%d)\n",
 				ret);
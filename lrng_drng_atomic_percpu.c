@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause
+/*
+ * LRNG per-CPU DRNG instances for atomic contexts
+ *
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/hardirq.h>
+#include <linux/local_lock.h>
+#include <linux/lrng.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+
+#include "lrng_drng_atomic.h"
+#include "lrng_drng_atomic_percpu.h"
+#include "lrng_drng_chacha20.h"
+
+/*
+ * Per-CPU ChaCha20 DRNG serving atomic callers. The DRNG is only accessed on
+ * its own CPU with interrupts disabled, i.e. without any shared lock. It is
+ * never reseeded by an atomic caller. When a reseed is due, the first atomic
+ * caller queues the reseed work on the CPU and all atomic callers use the other
+ * atomic DRNGs until the per-CPU DRNG is reseeded. The reseed work is not
+ * queued from NMI context. The reseed work pulls the seed from the DRNG of
+ * the NUMA node or the initial DRNG where sleeping is allowed.
+ *
+ * A forced reseed or a reset of the LRNG is propagated lazily by the reseed
+ * epoch of the DRNG manager: a per-CPU DRNG seeded in an older epoch is not
+ * used until it is reseeded.
+ */
+struct lrng_drng_atomic_pcpu {
+	local_lock_t lock;
+	struct chacha20_state chacha20;
+	struct work_struct seed_work;
+	unsigned long last_seeded;	/* Last time it was seeded */
+	u32 requests;			/* Number of DRNG requests */
+	u32 epoch;			/* Seed epoch of last seeding */
+	bool seeded;			/* Seeded from fully seeded DRNG */
+	bool seed_pending;		/* Reseed work is queued */
+};
+
+static DEFINE_PER_CPU(struct lrng_drng_atomic_pcpu, lrng_drng_atomic_pcpu) = {
+	.lock = INIT_LOCAL_LOCK(lock),
+	.chacha20 = { LRNG_CC20_INIT_RFC7539(.block) },
+};
+
+static bool lrng_drng_atomic_pcpu_avail __read_mostly = false;
+
+static bool
+lrng_drng_atomic_percpu_must_reseed(struct lrng_drng_atomic_pcpu *pcpu)
+{
+	return (!pcpu->seeded ||
+		pcpu->epoch != lrng_drng_epoch() ||
+		pcpu->requests >= LRNG_DRNG_RESEED_THRESH ||
+		time_after(jiffies,
+			   pcpu->last_seeded + lrng_drng_reseed_max_time * HZ));
+}
+
+/* Reseed the per-CPU DRNG of the CPU the work is queued on */
+static void lrng_drng_atomic_percpu_seed_work(struct work_struct *work)
+{
+	struct lrng_drng_atomic_pcpu *pcpu =
+		container_of(work, struct lrng_drng_atomic_pcpu, seed_work);
+	struct lrng_drng *drng = lrng_drng_node_instance();
+	u8 seedbuf[LRNG_DRNG_SECURITY_STRENGTH_BYTES]
+						__aligned(LRNG_KCAPI_ALIGN);
+	unsigned long flags;
+	u32 epoch;
+	int ret;
+
+	/* A reseed requested from now on queues the work again */
+	WRITE_ONCE(pcpu->seed_pending, false);
+
+	if (!drng->fully_seeded)
+		drng = lrng_drng_init_instance();
+	if (!drng->fully_seeded)
+		return;
+
+	/* The DRNG reseeds itself first if a reseed of all DRNGs was forced */
+	ret = lrng_drng_get_epoch(drng, seedbuf, sizeof(seedbuf), &epoch);
+	if (ret < 0) {
+		pr_warn("Error generating random numbers for per-CPU atomic DRNG: %d\n",
+			ret);
+		goto out;
+	}
+
+	local_lock_irqsave(&lrng_drng_atomic_pcpu.lock, flags);
+	/* The work is executed on another CPU if its CPU went offline */
+	if (pcpu == this_cpu_ptr(&lrng_drng_atomic_pcpu)) {
+		if (lrng_cc20_drng_cb.drng_seed(&pcpu->chacha20, seedbuf,
+						ret) < 0) {
+			pcpu->seeded = false;
+		} else {
+			pcpu->last_seeded = jiffies;
+			pcpu->requests = 0;
+			pcpu->epoch = epoch;
+			pcpu->seeded = drng->fully_seeded;
+		}
+	}
+	local_unlock_irqrestore(&lrng_drng_atomic_pcpu.lock, flags);
+
+out:
+	memzero_explicit(&seedbuf, sizeof(seedbuf));
+}
+
+/*
+ * lrng_drng_atomic_percpu_get() - Get random data out of the per-CPU atomic
+ * DRNG
+ *
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf - at most LRNG_DRNG_MAX_REQSIZE bytes are
+ *	       generated
+ *
+ * Return:
+ * * -EOPNOTSUPP if the per-CPU DRNG cannot be used
+ * * < 0 in error case (DRNG generation failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_atomic_percpu_get(u8 *outbuf, u32 outbuflen)
+{
+	struct lrng_drng_atomic_pcpu *pcpu;
+	unsigned long flags;
+	int ret = -EOPNOTSUPP;
+
+	/* The per-CPU DRNGs are only used once the LRNG is fully seeded */
+	if (!smp_load_acquire(&lrng_drng_atomic_pcpu_avail) ||
+	    !lrng_get_atomic()->fully_seeded)
+		return -EOPNOTSUPP;
+
+	outbuflen = min_t(u32, outbuflen, LRNG_DRNG_MAX_REQSIZE);
+
+	local_lock_irqsave(&lrng_drng_atomic_pcpu.lock, flags);
+	pcpu = this_cpu_ptr(&lrng_drng_atomic_pcpu);
+	if (lrng_drng_atomic_percpu_must_reseed(pcpu)) {
+		/* Queue the reseed work once, which is unsafe from NMI */
+		if (!pcpu->seed_pending && !in_nmi()) {
+			pcpu->seed_pending = true;
+			queue_work_on(smp_processor_id(), system_wq,
+				      &pcpu->seed_work);
+		}
+		goto out;
+	}
+
+	pcpu->requests++;
+	ret = lrng_cc20_drng_cb.drng_generate(&pcpu->chacha20, outbuf,
+					      outbuflen);
+
+out:
+	local_unlock_irqrestore(&lrng_drng_atomic_pcpu.lock, flags);
+	return ret;
+}
+
+static int __init lrng_drng_atomic_percpu_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct lrng_drng_atomic_pcpu *pcpu =
+			per_cpu_ptr(&lrng_drng_atomic_pcpu, cpu);
+
+		INIT_WORK(&pcpu->seed_work, lrng_drng_atomic_percpu_seed_work);
+	}
+
+	/* counterpart to smp_load_acquire in lrng_drng_atomic_percpu_get */
+	smp_store_release(&lrng_drng_atomic_pcpu_avail, true);
+
+	return 0;
+}
+
+late_initcall(lrng_drng_atomic_percpu_init);
@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/*
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#ifndef _LRNG_DRNG_ATOMIC_PERCPU_H
+#define _LRNG_DRNG_ATOMIC_PERCPU_H
+
+#include "lrng_drng_mgr.h"
+
+#ifdef CONFIG_LRNG_DRNG_ATOMIC_PERCPU
+int lrng_drng_atomic_percpu_get(u8 *outbuf, u32 outbuflen);
+#else /* CONFIG_LRNG_DRNG_ATOMIC_PERCPU */
+static inline int lrng_drng_atomic_percpu_get(u8 *outbuf, u32 outbuflen)
+{
+	return -EOPNOTSUPP;
+}
+#endif /* CONFIG_LRNG_DRNG_ATOMIC_PERCPU */
+
+#endif /* _LRNG_DRNG_ATOMIC_PERCPU_H */
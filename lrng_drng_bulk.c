@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause
+/*
+ * LRNG per-NUMA node DRNG instances for bulk requests
+ *
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/lrng.h>
+
+#include "lrng_drng_bulk.h"
+#include "lrng_drng_child.h"
+
+/*
+ * Requests of at least LRNG_DRNG_BULK_MIN_REQSIZE bytes are served by a
+ * separate DRNG instance per NUMA node. This way, small requests never wait
+ * for the DRNG lock held by bulk generation. The bulk DRNG is a child DRNG
+ * seeded from the DRNG that would serve the caller otherwise (the per-NUMA
+ * node DRNG or the initial DRNG).
+ */
+static struct lrng_drng_child *lrng_drng_bulk[MAX_NUMNODES];
+
+struct lrng_drng *lrng_drng_bulk_instance(int node)
+{
+	struct lrng_drng_child *child = READ_ONCE(lrng_drng_bulk[node]);
+
+	return child ? &child->drng : NULL;
+}
+
+void lrng_drng_bulk_reset(void)
+{
+	int node;
+
+	for_each_node(node) {
+		struct lrng_drng_child *child = READ_ONCE(lrng_drng_bulk[node]);
+
+		if (child)
+			lrng_drng_child_reset(child);
+	}
+}
+
+/*
+ * lrng_drng_bulk_get() - Get random data out of the bulk DRNG
+ *
+ * @parent: DRNG instance used to seed the bulk DRNG
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf
+ *
+ * Return:
+ * * -EOPNOTSUPP if no bulk DRNG is available
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_bulk_get(struct lrng_drng *parent, u8 *outbuf, u32 outbuflen)
+{
+	struct lrng_drng_child *child;
+	int node = numa_node_id();
+
+	child = READ_ONCE(lrng_drng_bulk[node]);
+	if (!child) {
+		child = lrng_drng_child_alloc(&lrng_drng_bulk[node], node);
+		if (!child)
+			return -EOPNOTSUPP;
+		pr_debug("bulk DRNG for NUMA node %d allocated\n", node);
+	}
+
+	return lrng_drng_child_get(child, parent, outbuf, outbuflen);
+}
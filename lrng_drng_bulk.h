@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/*
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#ifndef _LRNG_DRNG_BULK_H
+#define _LRNG_DRNG_BULK_H
+
+#include "lrng_drng_mgr.h"
+
+/* Minimum request size served by the bulk DRNG */
+#define LRNG_DRNG_BULK_MIN_REQSIZE	(LRNG_DRNG_MAX_REQSIZE >> 2)
+
+#ifdef CONFIG_LRNG_DRNG_BULK
+int lrng_drng_bulk_get(struct lrng_drng *parent, u8 *outbuf, u32 outbuflen);
+struct lrng_drng *lrng_drng_bulk_instance(int node);
+void lrng_drng_bulk_reset(void);
+#else /* CONFIG_LRNG_DRNG_BULK */
+static inline int
+lrng_drng_bulk_get(struct lrng_drng *parent, u8 *outbuf, u32 outbuflen)
+{
+	return -EOPNOTSUPP;
+}
+static inline struct lrng_drng *lrng_drng_bulk_instance(int node)
+{
+	return NULL;
+}
+static inline void lrng_drng_bulk_reset(void) { }
+#endif /* CONFIG_LRNG_DRNG_BULK */
+
+#endif /* _LRNG_DRNG_BULK_H */
@@ -131,7 +131,7 @@ static int lrng_cc20_drng_generate_helper(void *drng, u8 *outbuf, u32 outbuflen)
 /*
  * Allocation of the DRNG state
  */
-static void *lrng_cc20_drng_alloc(u32 sec_strength)
+static void *lrng_cc20_drng_alloc(u32 sec_strength, int node)
 {
 	struct chacha20_state *state = NULL;
 
@@ -144,7 +144,7 @@ static void *lrng_cc20_drng_alloc(u32 sec_strength)
 		pr_warn("Security strength of ChaCha20 DRNG (%u bits) higher than requested by LRNG (%u bits)\n",
 			CHACHA_KEY_SIZE * 8, sec_strength * 8);
 
-	state = kmalloc(sizeof(struct chacha20_state), GFP_KERNEL);
+	state = kmalloc_node(sizeof(struct chacha20_state), GFP_KERNEL, node);
 	if (!state)
 		return ERR_PTR(-ENOMEM);
 	pr_debug("memory for ChaCha20 core allocated\n");
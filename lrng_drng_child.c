@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause
+/*
+ * LRNG DRNG instances seeded from another DRNG
+ *
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/lrng.h>
+#include <linux/slab.h>
+
+#include "lrng_drng_child.h"
+
+/*
+ * A child DRNG is seeded from its parent DRNG (e.g. the per-NUMA node DRNG or
+ * the initial DRNG) which in turn is seeded from the entropy sources. The
+ * child DRNG is reseeded when:
+ *
+ * * its reseed threshold or reseed time is reached,
+ * * a reseed of all DRNGs is enforced by lrng_drng_force_reseed,
+ * * the parent DRNG was reseeded since the last seeding of the child DRNG,
+ * * a different parent DRNG serves the caller.
+ */
+
+/*
+ * Allocate a child DRNG and store it in the slot unless another caller
+ * allocated it concurrently. Return the DRNG stored in the slot or NULL on
+ * error.
+ */
+struct lrng_drng_child *lrng_drng_child_alloc(struct lrng_drng_child **slot,
+					      int node)
+{
+	struct lrng_drng *lrng_drng_init = lrng_drng_init_instance();
+	struct lrng_drng_child *child;
+
+	child = kzalloc_node(sizeof(*child), GFP_KERNEL, node);
+	if (!child)
+		return NULL;
+
+	mutex_init(&child->drng.lock);
+	rwlock_init(&child->drng.hash_lock);
+	spin_lock_init(&child->drng.spin_lock);
+	child->drng.node = NUMA_NO_NODE;
+
+	/* Prevent a DRNG switch while allocating the DRNG */
+	mutex_lock(&lrng_crypto_cb_update);
+
+	if (lrng_drng_alloc_common(&child->drng, lrng_drng_init->drng_cb,
+				   node)) {
+		mutex_unlock(&lrng_crypto_cb_update);
+		kfree(child);
+		return NULL;
+	}
+
+	if (cmpxchg(slot, NULL, child)) {
+		child->drng.drng_cb->drng_dealloc(child->drng.drng);
+		kfree(child);
+		child = READ_ONCE(*slot);
+	}
+
+	mutex_unlock(&lrng_crypto_cb_update);
+
+	return child;
+}
+
+void lrng_drng_child_reset(struct lrng_drng_child *child)
+{
+	mutex_lock(&child->drng.lock);
+	lrng_drng_reset(&child->drng);
+	mutex_unlock(&child->drng.lock);
+}
+
+static bool lrng_drng_child_must_reseed(struct lrng_drng_child *child,
+					struct lrng_drng *parent)
+{
+	struct lrng_drng *drng = &child->drng;
+
+	return (lrng_drng_requests_dec(drng) ||
+		!drng->fully_seeded ||
+		drng->force_reseed ||
+		lrng_drng_epoch_stale(drng) ||
+		child->parent != parent ||
+		child->parent_seeded != READ_ONCE(parent->last_seeded) ||
+		time_after(jiffies,
+			   drng->last_seeded + lrng_drng_reseed_max_time * HZ));
+}
+
+/*
+ * Seed the child DRNG from its parent DRNG. A child DRNG failing to obtain its
+ * seed must not generate random numbers until it is seeded.
+ */
+static int lrng_drng_child_seed(struct lrng_drng_child *child,
+				struct lrng_drng *parent)
+{
+	u8 seedbuf[LRNG_DRNG_SECURITY_STRENGTH_BYTES]
+						__aligned(LRNG_KCAPI_ALIGN);
+	u32 epoch;
+	int ret;
+
+	/*
+	 * The parent DRNG reseeds itself from the entropy sources if needed.
+	 * The seed is as recent as the seed of the parent DRNG used for it.
+	 */
+	ret = lrng_drng_get_epoch(parent, seedbuf, sizeof(seedbuf), &epoch);
+
+	mutex_lock(&child->drng.lock);
+	if (ret < 0) {
+		pr_warn("Error generating random numbers for child DRNG: %d\n",
+			ret);
+		child->drng.force_reseed = true;
+	} else {
+		lrng_drng_inject(&child->drng, seedbuf, ret,
+				 parent->fully_seeded, "child");
+		child->parent = parent;
+		child->parent_seeded = READ_ONCE(parent->last_seeded);
+		WRITE_ONCE(child->drng.seed_epoch, epoch);
+	}
+	mutex_unlock(&child->drng.lock);
+
+	memzero_explicit(&seedbuf, sizeof(seedbuf));
+
+	return ret < 0 ? ret : 0;
+}
+
+/*
+ * lrng_drng_child_get() - Get random data out of a child DRNG
+ *
+ * @child: child DRNG instance
+ * @parent: DRNG instance used to seed the child DRNG
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf
+ *
+ * Return:
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_child_get(struct lrng_drng_child *child,
+			struct lrng_drng *parent, u8 *outbuf, u32 outbuflen)
+{
+	u32 processed = 0;
+
+	if (!outbuf || !outbuflen)
+		return 0;
+
+	outbuflen = min_t(size_t, outbuflen, INT_MAX);
+
+	while (outbuflen) {
+		u32 todo;
+		int ret;
+
+		if (lrng_drng_child_must_reseed(child, parent)) {
+			ret = lrng_drng_child_seed(child, parent);
+			if (ret < 0)
+				return ret;
+		}
+
+		mutex_lock(&child->drng.lock);
+		todo = min_t(u32, outbuflen, lrng_drng_reqsize(&child->drng));
+		ret = child->drng.drng_cb->drng_generate(child->drng.drng,
+							 outbuf + processed,
+							 todo);
+		mutex_unlock(&child->drng.lock);
+		if (ret <= 0) {
+			pr_warn("getting random data from child DRNG failed (%d)\n",
+				ret);
+			return -EFAULT;
+		}
+		processed += ret;
+		outbuflen -= ret;
+	}
+
+	return processed;
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/*
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#ifndef _LRNG_DRNG_CHILD_H
+#define _LRNG_DRNG_CHILD_H
+
+#include "lrng_drng_mgr.h"
+
+/*
+ * DRNG instance which is seeded from another DRNG (the parent) instead of
+ * the entropy sources.
+ */
+struct lrng_drng_child {
+	struct lrng_drng drng;		/* DRNG instance */
+	struct lrng_drng *parent;	/* DRNG providing the seed */
+	unsigned long parent_seeded;	/* Seed time of parent when seeded */
+};
+
+struct lrng_drng_child *lrng_drng_child_alloc(struct lrng_drng_child **slot,
+					      int node);
+int lrng_drng_child_get(struct lrng_drng_child *child,
+			struct lrng_drng *parent, u8 *outbuf, u32 outbuflen);
+void lrng_drng_child_reset(struct lrng_drng_child *child);
+
+#endif /* _LRNG_DRNG_CHILD_H */
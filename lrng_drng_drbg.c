@@ -86,7 +86,7 @@ static int lrng_drbg_drng_generate_helper(void* drng, u8* outbuf, u32 outbuflen)
 	return drbg->d_ops->generate(drbg, outbuf, outbuflen, NULL);
 }
 
-static void* lrng_drbg_drng_alloc(u32 sec_strength)
+static void* lrng_drbg_drng_alloc(u32 sec_strength, int node)
 {
 	struct drbg_state* drbg;
 	int coreref = -1;
@@ -98,7 +98,8 @@ static void* lrng_drbg_drng_alloc(u32 sec_strength)
 	if (coreref < 0)
 		return ERR_PTR(-EFAULT);
 
-	drbg = kzalloc(sizeof(struct drbg_state), GFP_KERNEL);
+	/* The DRBG internal buffers are allocated by the DRBG without node */
+	drbg = kzalloc_node(sizeof(struct drbg_state), GFP_KERNEL, node);
 	if (!drbg)
 		return ERR_PTR(-ENOMEM);
 
@@ -149,12 +150,15 @@ static const char* lrng_drbg_name(void)
 	return lrng_drbg_types[lrng_drbg_type].drbg_core;
 }
 
+/* The kernel DRBG limits one generate call to 1<<16 bytes */
 const struct lrng_drng_cb lrng_drbg_cb = {
 	.drng_name = lrng_drbg_name,
 	.drng_alloc = lrng_drbg_drng_alloc,
 	.drng_dealloc = lrng_drbg_drng_dealloc,
 	.drng_seed = lrng_drbg_drng_seed_helper,
 	.drng_generate = lrng_drbg_drng_generate_helper,
+	.drng_max_reqsize = 1 << 16,
+	.drng_chunksize = 1 << 16,
 };
 
 static int __init lrng_drbg_selftest(void)
@@ -73,7 +73,7 @@ static int lrng_kcapi_drng_generate_helper(void *drng, u8 *outbuf,
 	return outbuflen;
 }
 
-static void *lrng_kcapi_drng_alloc(u32 sec_strength)
+static void *lrng_kcapi_drng_alloc(u32 sec_strength, int node)
 {
 	struct lrng_drng_info *lrng_drng_info;
 	struct crypto_rng *kcapi_rng;
@@ -94,10 +94,12 @@ static void *lrng_kcapi_drng_alloc(u32 sec_strength)
 		return ERR_PTR(-EINVAL);
 	}
 
-	lrng_drng_info = kzalloc(sizeof(*lrng_drng_info), GFP_KERNEL);
+	lrng_drng_info = kzalloc_node(sizeof(*lrng_drng_info), GFP_KERNEL,
+				      node);
 	if (!lrng_drng_info)
 		return ERR_PTR(-ENOMEM);
 
+	/* The kernel crypto API does not offer a node for RNG and hash TFMs */
 	kcapi_rng = crypto_alloc_rng(drng_name, 0, 0);
 	if (IS_ERR(kcapi_rng)) {
 		pr_err("DRNG %s cannot be allocated\n", drng_name);
@@ -10,20 +10,27 @@
 #include <linux/lrng.h>
 #include <linux/fips.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
 #include <linux/sched.h>
+#include <linux/sched/signal.h>
 #include <linux/wait.h>
 
 #include "lrng_drng_atomic.h"
+#include "lrng_drng_bulk.h"
 #include "lrng_drng_chacha20.h"
 #include "lrng_drng_drbg.h"
 #include "lrng_drng_kcapi.h"
 #include "lrng_drng_mgr.h"
+#include "lrng_drng_percpu.h"
 #include "lrng_es_aux.h"
 #include "lrng_es_mgr.h"
 #include "lrng_interface_random_kernel.h"
 #include "lrng_numa.h"
 #include "lrng_sha.h"
 
+#define CREATE_TRACE_POINTS
+#include "lrng_trace.h"
+
 /*
  * Maximum number of seconds between DRNG reseed intervals of the DRNG. Note,
  * this is enforced with the next request of random numbers from the
@@ -69,6 +76,7 @@ static struct lrng_drng lrng_drng_init = {
 	LRNG_DRNG_STATE_INIT(lrng_drng_init, NULL, NULL, NULL,
 			     &lrng_sha_hash_cb),
 	.lock = __MUTEX_INITIALIZER(lrng_drng_init.lock),
+	.spin_lock = __SPIN_LOCK_UNLOCKED(lrng_drng_init.spin_lock),
 };
 
 /* Prediction-resistance DRNG: only deliver as much data as received entropy */
@@ -76,6 +84,8 @@ static struct lrng_drng lrng_drng_pr = {
 	LRNG_DRNG_STATE_INIT(lrng_drng_pr, NULL, NULL, NULL,
 			     &lrng_sha_hash_cb),
 	.lock = __MUTEX_INITIALIZER(lrng_drng_pr.lock),
+	.spin_lock = __SPIN_LOCK_UNLOCKED(lrng_drng_pr.spin_lock),
+	.pr = true,
 };
 
 static u32 max_wo_reseed = LRNG_DRNG_MAX_WITHOUT_RESEED;
@@ -92,9 +102,55 @@ MODULE_PARM_DESC(force_seeding,
 		 "Allow disabling of the forced seeding when insufficient entropy is available\n");
 #endif
 
+static u32 es_weight = LRNG_DRNG_ES_WEIGHT;
+static u32 es_weight_pr = LRNG_DRNG_ES_WEIGHT_PR;
+#ifdef CONFIG_LRNG_DRNG_ES_FAIR_SHARE
+module_param(es_weight, uint, 0644);
+MODULE_PARM_DESC(es_weight,
+		 "Weight of the regular DRNGs for the allocation of entropy\n");
+module_param(es_weight_pr, uint, 0644);
+MODULE_PARM_DESC(es_weight_pr,
+		 "Weight of the prediction resistance DRNGs for the allocation of entropy\n");
+#endif
+
 /* Wait queue to wait until the LRNG is initialized - can freely be used */
 DECLARE_WAIT_QUEUE_HEAD(lrng_init_wait);
 
+/* Number of concurrent reseeds of DRNGs holding the seeding lock shared */
+static atomic_t lrng_drng_seeds = ATOMIC_INIT(0);
+
+/*
+ * Reseed epoch: A forced reseed of all DRNGs, e.g. after a VM fork, only
+ * advances the epoch instead of visiting every DRNG instance. Every DRNG
+ * records the epoch read before collecting its seed and reseeds on its next
+ * use when the epoch advanced since then. A stale epoch requires a synchronous
+ * reseed before the DRNG generates data. Thus, a caller of lrng_drng_get
+ * finding the seeding lock taken waits until it obtains the seeding lock or
+ * another caller reseeded the DRNG. The waiters are woken when a seeding lock
+ * is released.
+ */
+static atomic_t lrng_drng_reseed_epoch = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(lrng_drng_seed_wait);
+static atomic_t lrng_drng_seed_unlocks = ATOMIC_INIT(0);
+
+u32 lrng_drng_epoch(void)
+{
+	return (u32)atomic_read(&lrng_drng_reseed_epoch);
+}
+
+/* Wait queue of the emergency seeding waiting for new entropy */
+static DECLARE_WAIT_QUEUE_HEAD(lrng_drng_es_wait);
+static atomic_t lrng_drng_es_events = ATOMIC_INIT(0);
+
+/* Batch of DRNG requests a CPU accounts locally */
+struct lrng_drng_requests_batch {
+	struct lrng_drng *drng;		/* DRNG the batch is taken from */
+	u32 requests_gen;		/* Generation of the DRNG requests */
+	u32 left;			/* Requests left in the batch */
+};
+
+static DEFINE_PER_CPU(struct lrng_drng_requests_batch, lrng_drng_requests_batch);
+
 /********************************** Helper ************************************/
 
 bool lrng_get_available(void)
@@ -117,27 +173,433 @@ struct lrng_drng *lrng_drng_node_instance(void)
 	struct lrng_drng **lrng_drng = lrng_drng_instances();
 	int node = numa_node_id();
 
-	if (lrng_drng && lrng_drng[node])
-		return lrng_drng[node];
+	/* The DRNG of the node may go online or offline concurrently */
+	if (lrng_drng)
+		return READ_ONCE(lrng_drng[node]) ?: lrng_drng_init_instance();
 
 	return lrng_drng_init_instance();
 }
 
+/*
+ * Is the DRNG a prediction resistance DRNG? The type is set when the DRNG is
+ * allocated and kept when its NUMA node goes offline.
+ */
+static bool lrng_drng_is_pr(struct lrng_drng *drng)
+{
+	return drng->pr;
+}
+
+/*
+ * NUMA node whose entropy is preferred when seeding the DRNG from the entropy
+ * sources or NUMA_NO_NODE if all entropy is treated alike. The initial and
+ * the prediction resistance DRNGs are the fallback of all NUMA nodes and
+ * therefore serve no particular node.
+ */
+static int lrng_drng_es_node(struct lrng_drng *drng)
+{
+	if (!IS_ENABLED(CONFIG_LRNG_ES_NUMA_LOCAL))
+		return NUMA_NO_NODE;
+
+	return drng->node;
+}
+
+/*
+ * Number of bytes to generate with one generate operation of the DRNG while
+ * holding its lock. The DRNG may declare its preferred chunk size and its
+ * maximum request size, LRNG_DRNG_MAX_REQSIZE applies otherwise. The caller
+ * must hold the DRNG lock to rely on the value as the DRNG type may change
+ * otherwise.
+ */
+u32 lrng_drng_reqsize(struct lrng_drng *drng)
+{
+	const struct lrng_drng_cb *drng_cb = READ_ONCE(drng->drng_cb);
+	u32 reqsize;
+
+	/* DRNG is not yet allocated */
+	if (!drng_cb)
+		return LRNG_DRNG_MAX_REQSIZE;
+
+	reqsize = drng_cb->drng_chunksize ? : LRNG_DRNG_MAX_REQSIZE;
+	if (drng_cb->drng_max_reqsize)
+		reqsize = min_t(u32, reqsize, drng_cb->drng_max_reqsize);
+
+	return reqsize;
+}
+
+/*
+ * With CONFIG_LRNG_DRNG_NODE_ATOMIC, the initial DRNG and the per-NUMA node
+ * DRNGs serve atomic callers when they use the ChaCha20 DRNG which never
+ * sleeps. In this case, the DRNG state is protected by the spin lock in
+ * addition to the mutex: sleeping callers hold the mutex and take the spin
+ * lock only for the DRNG operation, atomic callers only take the spin lock.
+ * As the DRNG type is only switched while holding the mutex, a mutex holder
+ * can rely on this check.
+ */
+static bool lrng_drng_is_atomic(struct lrng_drng *drng)
+{
+#ifdef CONFIG_LRNG_DRNG_NODE_ATOMIC
+	return (drng->drng_cb == &lrng_cc20_drng_cb &&
+		!lrng_drng_is_pr(drng) && drng != lrng_get_atomic());
+#else
+	return false;
+#endif
+}
+
+/* Lock the DRNG state against atomic callers - caller must hold the mutex */
+void lrng_drng_state_lock(struct lrng_drng *drng, unsigned long *flags)
+{
+	if (lrng_drng_is_atomic(drng))
+		spin_lock_irqsave(&drng->spin_lock, *flags);
+}
+
+void lrng_drng_state_unlock(struct lrng_drng *drng, unsigned long *flags)
+{
+	if (lrng_drng_is_atomic(drng))
+		spin_unlock_irqrestore(&drng->spin_lock, *flags);
+}
+
+/*
+ * Seeding lock: Before the LRNG is operational, every reseed updates the
+ * seeding state of the LRNG and therefore holds the pool lock exclusively.
+ * Once the LRNG is operational, the reseeds of different DRNGs run
+ * concurrently. They hold the pool lock shared which excludes the exclusive
+ * holders, e.g. the seed work and lrng_get_seed. The seeding flag of the DRNG
+ * prevents concurrent reseeds of the same DRNG. Another concurrent reseed is
+ * only started when the available entropy suffices to fully seed all DRNGs
+ * reseeding concurrently. Otherwise, the reseeds would split the available
+ * entropy such that none of them receives the requested entropy.
+ *
+ * Return: true if the seeding lock is taken, false otherwise.
+ */
+static bool lrng_drng_seed_trylock(struct lrng_drng *drng, bool *shared)
+{
+	int seeds;
+
+	*shared = lrng_state_operational();
+	if (!*shared)
+		return lrng_pool_trylock();
+
+	if (!lrng_pool_trylock_shared())
+		return false;
+
+	if (atomic_cmpxchg(&drng->seeding, 0, 1))
+		goto unlock;
+
+	seeds = atomic_inc_return(&lrng_drng_seeds);
+	if (seeds > 1 &&
+	    lrng_avail_entropy() < seeds * lrng_get_seed_entropy_osr(true)) {
+		atomic_dec(&lrng_drng_seeds);
+		atomic_set_release(&drng->seeding, 0);
+		goto unlock;
+	}
+
+	return true;
+
+unlock:
+	lrng_pool_unlock_shared();
+	return false;
+}
+
+static void lrng_drng_seed_unlock(struct lrng_drng *drng, bool shared)
+{
+	if (shared) {
+		atomic_dec(&lrng_drng_seeds);
+		atomic_set_release(&drng->seeding, 0);
+		lrng_pool_unlock_shared();
+	} else {
+		lrng_pool_unlock();
+	}
+
+	/* Counted always to not miss a waiter which is about to sleep */
+	atomic_inc(&lrng_drng_seed_unlocks);
+	if (wq_has_sleeper(&lrng_drng_seed_wait))
+		wake_up_all(&lrng_drng_seed_wait);
+}
+
+/*
+ * Wait for the seeding lock of a DRNG with a stale reseed epoch. The wait for
+ * the release of the seeding lock is limited as the pool lock held
+ * exclusively and the admission of concurrent reseeds depending on the
+ * available entropy do not wake the waiters.
+ *
+ * Return: true if the seeding lock is taken, false if the DRNG was reseeded
+ *	   in the meantime.
+ */
+static bool lrng_drng_seed_lock_stale(struct lrng_drng *drng, bool *shared)
+{
+	might_sleep();
+
+	while (lrng_drng_epoch_stale(drng)) {
+		int unlocks = atomic_read(&lrng_drng_seed_unlocks);
+
+		if (lrng_drng_seed_trylock(drng, shared))
+			return true;
+
+		wait_event_timeout(lrng_drng_seed_wait,
+			atomic_read(&lrng_drng_seed_unlocks) != unlocks ||
+			!lrng_drng_epoch_stale(drng),
+			msecs_to_jiffies(LRNG_DRNG_EMERGENCY_SEED_MAX_WAIT_MS));
+	}
+
+	return false;
+}
+
+/*
+ * Account one generate request of the DRNG. The request is accounted in a
+ * per-CPU batch such that the shared request counter of the DRNG is only
+ * updated once per LRNG_DRNG_REQUESTS_BATCH requests of a CPU. A batch is
+ * discarded when the request counter of the DRNG is set anew with a reseed
+ * or reset of the DRNG. When the CPU accounts a request of another DRNG, the
+ * unused requests of the batch are returned to the DRNG the batch is taken
+ * from such that CPUs alternating between DRNGs do not drain their counters.
+ * A reseed racing with the return merely delays the next reseed by less than
+ * one batch. The DRNGs are never freed, which allows the return.
+ *
+ * Return: true if the reseed threshold of the DRNG is reached with this
+ *	   request, false otherwise.
+ */
+bool lrng_drng_requests_dec(struct lrng_drng *drng)
+{
+	struct lrng_drng_requests_batch *batch;
+	unsigned long flags;
+	bool reseed = false;
+
+	BUILD_BUG_ON(LRNG_DRNG_REQUESTS_BATCH > LRNG_DRNG_RESEED_THRESH);
+
+	local_irq_save(flags);
+	batch = this_cpu_ptr(&lrng_drng_requests_batch);
+	if (batch->drng != drng ||
+	    batch->requests_gen != READ_ONCE(drng->requests_gen) ||
+	    !batch->left) {
+		int left;
+
+		if (batch->drng && batch->drng != drng && batch->left &&
+		    batch->requests_gen == READ_ONCE(batch->drng->requests_gen))
+			atomic_add(batch->left, &batch->drng->requests);
+
+		left = atomic_sub_return(LRNG_DRNG_REQUESTS_BATCH,
+					 &drng->requests);
+
+		/* Only the batch crossing the threshold triggers the reseed */
+		reseed = (left <= 0 && left + LRNG_DRNG_REQUESTS_BATCH > 0);
+
+		batch->drng = drng;
+		batch->requests_gen = READ_ONCE(drng->requests_gen);
+		batch->left = LRNG_DRNG_REQUESTS_BATCH;
+	}
+	batch->left--;
+	local_irq_restore(flags);
+
+	return reseed;
+}
+
+/*
+ * Reseed scheduler: The time-based reseeds of the per-NUMA node DRNGs are
+ * spread evenly over the reseed interval. Each DRNG owns one slot of the
+ * interval given by its position among the per-NUMA node DRNGs. When a DRNG
+ * is reseeded, its next time-based reseed is scheduled at the next start of
+ * its slot. Thus, a DRNG is reseeded at the latest after the reseed interval
+ * while the reseeds of the different DRNGs do not occur at the same time. As a
+ * reseed triggered by requests may occur shortly before the start of the slot,
+ * the next time-based reseed is at the earliest one slot length later. All
+ * other DRNGs are scheduled for a reseed after the full reseed interval.
+ */
+static unsigned long lrng_drng_sched_deadline(struct lrng_drng *drng)
+{
+	struct lrng_drng **lrng_drng = lrng_drng_instances();
+	unsigned long interval = lrng_drng_reseed_max_time * HZ,
+		      now = jiffies, slot_len, deadline;
+	u32 slot = 0, slots = 0;
+	bool found = false;
+	int node;
+
+	if (!interval)
+		return now;
+	if (!lrng_drng)
+		return now + interval;
+
+	for_each_online_node(node) {
+		if (!lrng_drng[node])
+			continue;
+		if (lrng_drng[node] == drng) {
+			slot = slots;
+			found = true;
+		}
+		slots++;
+	}
+
+	if (!found)
+		return now + interval;
+
+	slot_len = interval / slots;
+	deadline = now + interval - ((now - slot_len * slot) % interval);
+	if (time_before(deadline, now + slot_len))
+		deadline = now + slot_len;
+
+	return deadline;
+}
+
+/*
+ * The entropy sources did not deliver entropy for the reseed of the fully
+ * seeded DRNG. Instead of waiting for the next slot of the DRNG, the reseed is
+ * retried when entropy may be available again. Caller must hold DRNG lock.
+ */
+static void lrng_drng_sched_retry(struct lrng_drng *drng)
+{
+	unsigned long retry = jiffies + LRNG_DRNG_RESEED_RETRY_TIME * HZ;
+
+	if (drng->fully_seeded && time_before(retry, drng->reseed_deadline))
+		drng->reseed_deadline = retry;
+}
+
+/*
+ * Entropy allocator: The DRNGs seeded from the entropy sources after the LRNG
+ * is fully seeded share the entropy by weight. The entropy harvested by a DRNG
+ * is accounted in its virtual consumption which grows inversely to its
+ * weight. A harvest that does not deliver the requested entropy marks the DRNG
+ * as starved. As long as another DRNG is starved and keeps retrying its
+ * reseed, a DRNG whose virtual consumption is ahead of the starved DRNG by
+ * more than one full seed defers its harvest and reseeds with the time stamp
+ * only. This leaves the entropy to the starved DRNG. The deferral is treated
+ * like a reseed which did not obtain entropy, i.e. the reseed is retried
+ * shortly, and a harvest is never deferred longer than the reseed interval.
+ */
+static u32 lrng_drng_es_weight(struct lrng_drng *drng)
+{
+	u32 weight = lrng_drng_is_pr(drng) ? READ_ONCE(es_weight_pr) :
+					     READ_ONCE(es_weight);
+
+	return max_t(u32, weight, 1);
+}
+
+/*
+ * Is the other DRNG starved and behind the DRNG? The entropy allocation state
+ * of the other DRNG is updated concurrently by its own reseed.
+ */
+static bool lrng_drng_es_starved(struct lrng_drng *drng,
+				 struct lrng_drng *other)
+{
+	if (!other || other == drng || !READ_ONCE(other->es_starved))
+		return false;
+
+	/* A DRNG which does not retry its reseed is not starved any more */
+	if (time_after(jiffies, READ_ONCE(other->es_harvested) +
+				2 * LRNG_DRNG_RESEED_RETRY_TIME * HZ))
+		return false;
+
+	return ((long)(drng->es_vtime - READ_ONCE(other->es_vtime)) >
+		(long)((LRNG_DRNG_SECURITY_STRENGTH_BITS << 8) /
+		       lrng_drng_es_weight(drng)));
+}
+
+/*
+ * Shall the DRNG defer its harvest? Caller must hold the seeding lock of the
+ * DRNG which serializes the updates of its entropy allocation state. The
+ * state of the other DRNGs is read without their seeding locks.
+ */
+static bool lrng_drng_es_defer(struct lrng_drng *drng)
+{
+	struct lrng_drng **lrng_drng;
+	int node;
+
+	if (!IS_ENABLED(CONFIG_LRNG_DRNG_ES_FAIR_SHARE))
+		return false;
+
+	/*
+	 * The initial, emergency and forced seeding is never deferred. Neither
+	 * is the seeding of a PR DRNG as it only generates as much data as
+	 * entropy it received with the seeding.
+	 */
+	if (!lrng_state_fully_seeded() || drng->force_reseed ||
+	    lrng_drng_epoch_stale(drng) || !drng->fully_seeded ||
+	    lrng_drng_is_pr(drng))
+		return false;
+
+	if (!time_before(jiffies, drng->es_harvested +
+				  lrng_drng_reseed_max_time * HZ))
+		return false;
+
+	lrng_drng = lrng_drng_instances();
+	if (lrng_drng) {
+		for_each_online_node(node) {
+			if (lrng_drng_es_starved(drng,
+						 READ_ONCE(lrng_drng[node])))
+				return true;
+		}
+	} else if (lrng_drng_es_starved(drng, &lrng_drng_init)) {
+		return true;
+	}
+
+	lrng_drng = lrng_drng_pr_instances();
+	if (lrng_drng) {
+		for_each_online_node(node) {
+			if (lrng_drng_es_starved(drng,
+						 READ_ONCE(lrng_drng[node])))
+				return true;
+		}
+	} else if (lrng_drng_es_starved(drng, &lrng_drng_pr)) {
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Account the harvest of the DRNG - caller must hold the seeding lock of the
+ * DRNG. The reseeds of the other DRNGs read the updated state concurrently.
+ */
+static void lrng_drng_es_account(struct lrng_drng *drng, u32 requested_bits,
+				 u32 collected_bits, bool deferred)
+{
+	bool starved = (collected_bits < requested_bits);
+
+	if (deferred) {
+		atomic_inc(&drng->es_deferrals);
+		return;
+	}
+
+	if (collected_bits)
+		atomic_inc(&drng->es_harvests);
+	WRITE_ONCE(drng->es_vtime,
+		   drng->es_vtime + DIV_ROUND_UP(collected_bits << 8,
+						 lrng_drng_es_weight(drng)));
+	WRITE_ONCE(drng->es_harvested, jiffies);
+	WRITE_ONCE(drng->es_starved, starved);
+	if (starved)
+		atomic_inc(&drng->es_starvations);
+}
+
 void lrng_drng_reset(struct lrng_drng *drng)
 {
 	/* Ensure reseed during next call */
 	atomic_set(&drng->requests, 1);
+	WRITE_ONCE(drng->requests_gen, drng->requests_gen + 1);
 	atomic_set(&drng->requests_since_fully_seeded, 0);
 	drng->last_seeded = jiffies;
+	drng->reseed_deadline = drng->last_seeded;
 	drng->fully_seeded = false;
 	/* Do not set force, as this flag is used for the emergency reseeding */
 	drng->force_reseed = false;
+	atomic_set(&drng->async_reseed, 0);
+	WRITE_ONCE(drng->es_starved, false);
 	pr_debug("reset DRNG\n");
 }
 
-/* Initialize the DRNG, except the mutex lock */
+/* Reset the DRNG while holding its lock and its state lock */
+void lrng_drng_lock_reset(struct lrng_drng *drng)
+{
+	unsigned long flags;
+
+	mutex_lock(&drng->lock);
+	lrng_drng_state_lock(drng, &flags);
+	lrng_drng_reset(drng);
+	lrng_drng_state_unlock(drng, &flags);
+	mutex_unlock(&drng->lock);
+}
+
+/* Initialize the DRNG on the given NUMA node, except the mutex lock */
 int lrng_drng_alloc_common(struct lrng_drng *drng,
-			   const struct lrng_drng_cb *drng_cb)
+			   const struct lrng_drng_cb *drng_cb, int node)
 {
 	if (!drng || !drng_cb)
 		return -EINVAL;
@@ -145,7 +607,8 @@ int lrng_drng_alloc_common(struct lrng_drng *drng,
 		return 0;
 
 	drng->drng_cb = drng_cb;
-	drng->drng = drng_cb->drng_alloc(LRNG_DRNG_SECURITY_STRENGTH_BYTES);
+	drng->drng = drng_cb->drng_alloc(LRNG_DRNG_SECURITY_STRENGTH_BYTES,
+					 node);
 	if (IS_ERR(drng->drng))
 		return -PTR_ERR(drng->drng);
 
@@ -172,12 +635,14 @@ int lrng_drng_initalize(void)
 
 	/* Initialize the PR DRNG inside init lock as it guards lrng_avail. */
 	mutex_lock(&lrng_drng_pr.lock);
-	ret = lrng_drng_alloc_common(&lrng_drng_pr, lrng_default_drng_cb);
+	ret = lrng_drng_alloc_common(&lrng_drng_pr, lrng_default_drng_cb,
+				     NUMA_NO_NODE);
 	mutex_unlock(&lrng_drng_pr.lock);
 
 	if (!ret) {
 		ret = lrng_drng_alloc_common(&lrng_drng_init,
-					     lrng_default_drng_cb);
+					     lrng_default_drng_cb,
+					     NUMA_NO_NODE);
 		if (!ret)
 			atomic_set(&lrng_avail, 1);
 	}
@@ -216,9 +681,16 @@ bool lrng_sp80090c_compliant(void)
 void lrng_drng_inject(struct lrng_drng *drng, const u8 *inbuf, u32 inbuflen,
 		      bool fully_seeded, const char *drng_type)
 {
+	u64 start = trace_lrng_drng_inject_enabled() ? ktime_get_ns() : 0;
+	int ret;
+
 	BUILD_BUG_ON(LRNG_DRNG_RESEED_THRESH > INT_MAX);
 	pr_debug("seeding %s DRNG with %u bytes\n", drng_type, inbuflen);
-	if (drng->drng_cb->drng_seed(drng->drng, inbuf, inbuflen) < 0) {
+	ret = drng->drng_cb->drng_seed(drng->drng, inbuf, inbuflen);
+	if (start)
+		trace_lrng_drng_inject(drng, drng_type, inbuflen, fully_seeded,
+				       ret, ktime_get_ns() - start);
+	if (ret < 0) {
 		pr_warn("seeding of %s DRNG failed\n", drng_type);
 		drng->force_reseed = true;
 	} else {
@@ -236,7 +708,9 @@ void lrng_drng_inject(struct lrng_drng *drng, const u8 *inbuf, u32 inbuflen,
 			atomic_add(gc, &drng->requests_since_fully_seeded);
 
 		drng->last_seeded = jiffies;
+		drng->reseed_deadline = lrng_drng_sched_deadline(drng);
 		atomic_set(&drng->requests, LRNG_DRNG_RESEED_THRESH);
+		WRITE_ONCE(drng->requests_gen, drng->requests_gen + 1);
 		drng->force_reseed = false;
 
 		if (!drng->fully_seeded) {
@@ -247,18 +721,98 @@ void lrng_drng_inject(struct lrng_drng *drng, const u8 *inbuf, u32 inbuflen,
 	}
 }
 
+void lrng_drng_es_notify(void)
+{
+	if (wq_has_sleeper(&lrng_drng_es_wait)) {
+		atomic_inc(&lrng_drng_es_events);
+		wake_up_interruptible(&lrng_drng_es_wait);
+	}
+}
+
+/*
+ * Wait until an entropy source reports new entropy, a signal is received or
+ * the timeout expires.
+ */
+static void lrng_drng_es_wait_event(unsigned long timeout)
+{
+	int events = atomic_read(&lrng_drng_es_events);
+
+	wait_event_interruptible_timeout(lrng_drng_es_wait,
+		atomic_read(&lrng_drng_es_events) != events, timeout);
+}
+
+/*
+ * Backoff of the emergency seeding: The entropy sources are polled at most
+ * LRNG_DRNG_EMERGENCY_SEED_PASSES times. Unless the entropy sources report
+ * sufficient entropy for the next pass, the seed worker waits until an entropy
+ * source reports new entropy. The wait is limited to one jiffy doubling with
+ * every pass up to LRNG_DRNG_EMERGENCY_SEED_MAX_WAIT_MS. As the waiting caller
+ * holds the DRNG lock and, before the LRNG is operational, the pool lock
+ * exclusively, only the seed worker which exists to perform the seeding waits.
+ * All other callers, e.g. the callers requesting random numbers, the boot time
+ * seeding and lrng_force_fully_seeded, perform the next pass right away.
+ *
+ * Return: true if another pass shall be performed, false otherwise.
+ */
+static bool lrng_drng_seed_es_backoff(struct lrng_drng *drng, u32 passes,
+				      u32 collected_entropy, bool backoff,
+				      const char *drng_type)
+{
+	u32 missing = lrng_get_seed_entropy_osr(false);
+	unsigned long timeout;
+	u64 start;
+
+	if (passes >= LRNG_DRNG_EMERGENCY_SEED_PASSES) {
+		pr_debug("Emergency seeding of %s DRNG stopped after %u passes with %u bits of entropy\n",
+			 drng_type, passes, collected_entropy);
+		return false;
+	}
+
+	missing = (missing > collected_entropy) ? missing - collected_entropy :
+						  0;
+	if (!backoff || lrng_avail_entropy() >= missing)
+		return true;
+
+	timeout = min_t(unsigned long, 1UL << (passes - 1),
+			msecs_to_jiffies(LRNG_DRNG_EMERGENCY_SEED_MAX_WAIT_MS));
+	start = trace_lrng_drng_seed_backoff_enabled() ? ktime_get_ns() : 0;
+	lrng_drng_es_wait_event(timeout);
+	if (start)
+		trace_lrng_drng_seed_backoff(drng, drng_type, passes,
+					     collected_entropy,
+					     ktime_get_ns() - start);
+
+	return !signal_pending(current);
+}
+
 /*
  * Perform the seeding of the DRNG with data from entropy source.
  * The function returns the entropy injected into the DRNG in bits.
+ *
+ * The caller must hold the DRNG lock unless lock_inject is set. With
+ * lock_inject, the entropy sources are harvested without holding the DRNG
+ * lock such that callers can continue to generate random numbers and the DRNG
+ * lock is only taken to inject the collected seed. No emergency seeding is
+ * performed in this case as it requires that the DRNG does not generate data
+ * between its passes.
  */
 static u32 lrng_drng_seed_es_nolock(struct lrng_drng *drng, bool init_ops,
+				    bool backoff, bool lock_inject,
 				    const char *drng_type)
 {
-	struct entropy_buf seedbuf __aligned(LRNG_KCAPI_ALIGN),
-			   collected_seedbuf;
-	u32 collected_entropy = 0;
+	struct entropy_buf seedbuf, collected_seedbuf;
+	u8 seedrec[LRNG_SEED_RECORD_MAX_BYTES] __aligned(LRNG_KCAPI_ALIGN);
+	u64 start = trace_lrng_drng_seed_es_enabled() ? ktime_get_ns() : 0;
+	u32 collected_entropy = 0, iterations = 0, seed_bits,
+	    requested_bits = lrng_get_seed_entropy_osr(drng->fully_seeded),
+	    epoch = lrng_drng_epoch();
 	unsigned int i, num_es_delivered = 0;
-	bool forced = drng->force_reseed;
+	int node = lrng_drng_es_node(drng);
+	unsigned long flags;
+	bool forced = drng->force_reseed,
+	     deferred = lrng_drng_es_defer(drng);
+
+	seed_bits = deferred ? 0 : requested_bits;
 
 	for_each_lrng_es(i)
 		collected_seedbuf.e_bits[i] = 0;
@@ -266,14 +820,20 @@ static u32 lrng_drng_seed_es_nolock(struct lrng_drng *drng, bool init_ops,
 	do {
 		/* Count the number of ES which delivered entropy */
 		num_es_delivered = 0;
+		iterations++;
 
 		if (collected_entropy)
 			pr_debug("Force fully seeding level for %s DRNG by repeatedly pull entropy from available entropy sources\n",
 				 drng_type);
 
-		lrng_fill_seed_buffer(&seedbuf,
-			lrng_get_seed_entropy_osr(drng->fully_seeded),
-				      forced && !drng->fully_seeded);
+		/* Repeated passes only poll entropy sources reporting entropy */
+		if (iterations > 1) {
+			lrng_fill_seed_buffer_avail(&seedbuf, seed_bits, node);
+		} else {
+			lrng_fill_seed_buffer(&seedbuf, seed_bits,
+					      forced && !drng->fully_seeded,
+					      node);
+		}
 
 		collected_entropy += lrng_entropy_rate_eb(&seedbuf);
 
@@ -283,11 +843,18 @@ static u32 lrng_drng_seed_es_nolock(struct lrng_drng *drng, bool init_ops,
 			num_es_delivered += !!seedbuf.e_bits[i];
 		}
 
-		lrng_drng_inject(drng, (u8 *)&seedbuf, sizeof(seedbuf),
+		if (lock_inject)
+			mutex_lock(&drng->lock);
+		lrng_drng_state_lock(drng, &flags);
+		lrng_drng_inject(drng, seedrec,
+				 lrng_seed_record(&seedbuf, seedrec),
 				 lrng_fully_seeded(drng->fully_seeded,
 						   collected_entropy,
 						   &collected_seedbuf),
 				 drng_type);
+		lrng_drng_state_unlock(drng, &flags);
+		if (lock_inject)
+			mutex_unlock(&drng->lock);
 
 		/*
 		 * Set the seeding state of the LRNG
@@ -309,49 +876,204 @@ static u32 lrng_drng_seed_es_nolock(struct lrng_drng *drng, bool init_ops,
 	 * The emergency reseeding implies that the consecutively injected
 	 * entropy can be added up. This is applicable due to the fact that
 	 * the entire operation is atomic which means that the DRNG is not
-	 * producing data while this is ongoing.
+	 * producing data while this is ongoing. The number of passes is
+	 * bounded and the passes are spaced by waiting for new entropy.
 	 */
-	} while (force_seeding && forced && !drng->fully_seeded &&
-		 num_es_delivered >= (lrng_ntg1_2024_compliant() ? 2 : 1));
+	} while (force_seeding && forced && !lock_inject &&
+		 !drng->fully_seeded &&
+		 num_es_delivered >= (lrng_ntg1_2024_compliant() ? 2 : 1) &&
+		 lrng_drng_seed_es_backoff(drng, iterations, collected_entropy,
+					   backoff, drng_type));
+
+	WRITE_ONCE(drng->seed_epoch, epoch);
+	lrng_drng_es_account(drng, requested_bits, collected_entropy, deferred);
+	if (!collected_entropy)
+		lrng_drng_sched_retry(drng);
+
+	if (start)
+		trace_lrng_drng_seed_es(drng, drng_type, requested_bits,
+					collected_entropy, iterations,
+					drng->fully_seeded,
+					ktime_get_ns() - start);
 
 	memzero_explicit(&seedbuf, sizeof(seedbuf));
+	memzero_explicit(seedrec, sizeof(seedrec));
 
 	return collected_entropy;
 }
 
-static void lrng_drng_seed_es(struct lrng_drng *drng)
+/*
+ * Seeding tree: With CONFIG_LRNG_DRNG_SEED_TREE, only the initial DRNG - the
+ * root of the tree - harvests the entropy sources after it is fully seeded.
+ * The other per-NUMA node DRNGs are (re)seeded with random numbers generated
+ * by the root DRNG with a security strength of
+ * LRNG_DRNG_SECURITY_STRENGTH_BITS. A node DRNG is reseeded from the root
+ * DRNG when its own reseed is due and after each harvest of the root DRNG.
+ * Thus, one harvest per reseed interval serves all node DRNGs instead of one
+ * harvest per node DRNG.
+ *
+ * The seed of a node DRNG has full entropy as long as the root DRNG is fully
+ * seeded since the output of a DRNG seeded with at least its security
+ * strength is indistinguishable from random for an observer not knowing the
+ * root DRNG state. This is the same argument that applies to the atomic DRNG
+ * and the child DRNGs. A node DRNG is therefore only considered fully seeded
+ * when seeded from a fully seeded root DRNG. The seed of a node DRNG is not
+ * more recent than the last harvest of the root DRNG: a compromise of the
+ * root DRNG state affects all node DRNGs until the root DRNG harvested fresh
+ * entropy and the node DRNGs were reseeded from it, which happens with their
+ * next request for random numbers. The root DRNG harvests when its own
+ * reseed is due, which includes the requests for seeding the node DRNGs,
+ * and when a reseed is forced. As long as the root DRNG is not fully seeded,
+ * all node DRNGs harvest the entropy sources themselves.
+ */
+
+/* Did the root DRNG harvest since it seeded the DRNG? */
+static bool lrng_drng_seed_root_harvested(struct lrng_drng *drng)
+{
+	struct lrng_drng *root = drng->seed_root;
+
+	return (root && root->fully_seeded &&
+		drng->seed_root_harvests != atomic_read(&root->es_harvests));
+}
+
+/*
+ * The reseed deadline is never later than the reseed interval after the last
+ * seeding. The reseed interval is still checked as it may be lowered at
+ * runtime.
+ */
+static bool lrng_drng_must_reseed(struct lrng_drng *drng)
 {
+	return (lrng_drng_requests_dec(drng) ||
+		drng->force_reseed ||
+		lrng_drng_epoch_stale(drng) ||
+		lrng_drng_seed_root_harvested(drng) ||
+		time_after(jiffies, drng->reseed_deadline) ||
+		time_after(jiffies,
+			   drng->last_seeded + lrng_drng_reseed_max_time * HZ));
+}
+
+/*
+ * Seed the DRNG with random numbers generated by the root DRNG - caller must
+ * hold the seeding lock.
+ */
+static int lrng_drng_seed_from_root(struct lrng_drng *drng,
+				    struct lrng_drng *root)
+{
+	u8 seedbuf[LRNG_DRNG_SECURITY_STRENGTH_BYTES]
+						__aligned(LRNG_KCAPI_ALIGN);
+	unsigned long flags;
+	u32 harvests, epoch;
+	bool fully_seeded;
+	int ret;
+
+	mutex_lock(&root->lock);
+	lrng_drng_state_lock(root, &flags);
+	ret = root->drng_cb->drng_generate(root->drng, seedbuf,
+					   sizeof(seedbuf));
+	lrng_drng_state_unlock(root, &flags);
+	harvests = atomic_read(&root->es_harvests);
+	fully_seeded = root->fully_seeded;
+	/* The seed is as recent as the seed of the root DRNG */
+	epoch = READ_ONCE(root->seed_epoch);
+	mutex_unlock(&root->lock);
+
+	if (ret < 0) {
+		pr_warn("Error generating random numbers from root DRNG: %d\n",
+			ret);
+		goto out;
+	}
+
 	mutex_lock(&drng->lock);
-	lrng_drng_seed_es_nolock(drng, true, "regular");
+	lrng_drng_state_lock(drng, &flags);
+	lrng_drng_inject(drng, seedbuf, ret, fully_seeded, "regular");
+	lrng_drng_state_unlock(drng, &flags);
+	drng->seed_root_harvests = harvests;
+	WRITE_ONCE(drng->seed_epoch, epoch);
+	atomic_inc(&drng->seed_root_seedings);
 	mutex_unlock(&drng->lock);
+	ret = 0;
+
+out:
+	memzero_explicit(&seedbuf, sizeof(seedbuf));
+	return ret;
 }
 
-static void lrng_drng_seed(struct lrng_drng *drng)
+/*
+ * Seed the DRNG - caller must hold the seeding lock. With async, the entropy
+ * sources are harvested without holding the DRNG lock, see
+ * lrng_drng_seed_es_nolock(). With backoff, the emergency seeding waits for
+ * new entropy between its passes, see lrng_drng_seed_es_backoff().
+ */
+static void lrng_drng_seed(struct lrng_drng *drng, bool async, bool backoff)
 {
+	u64 lock_wait = 0,
+	    start = trace_lrng_drng_seed_enabled() ? ktime_get_ns() : 0;
+
 	BUILD_BUG_ON(LRNG_MIN_SEED_ENTROPY_BITS >
 		     LRNG_DRNG_SECURITY_STRENGTH_BITS);
 
+	/* Only the root of the seeding tree harvests the entropy sources */
+	if (drng->seed_root && drng->seed_root->fully_seeded) {
+		struct lrng_drng *root = drng->seed_root;
+
+		/* Concurrent reseeds of node DRNGs harvest for the root once */
+		if (lrng_drng_must_reseed(root) &&
+		    !atomic_cmpxchg(&root->seeding, 0, 1)) {
+			lrng_drng_seed(root, false, false);
+			atomic_set_release(&root->seeding, 0);
+		}
+		/* A root DRNG seeded before a forced reseed must not be used */
+		if (root->fully_seeded && !lrng_drng_epoch_stale(root) &&
+		    !lrng_drng_seed_from_root(drng, root))
+			goto out;
+	}
+
 	/* (Re-)Seed DRNG */
-	lrng_drng_seed_es(drng);
+	if (async) {
+		lrng_drng_seed_es_nolock(drng, true, false, true, "regular");
+	} else {
+		mutex_lock(&drng->lock);
+		if (start)
+			lock_wait = ktime_get_ns() - start;
+		lrng_drng_seed_es_nolock(drng, true, backoff, false,
+					 "regular");
+		mutex_unlock(&drng->lock);
+	}
+
+out:
 	/* (Re-)Seed atomic DRNG from regular DRNG */
 	lrng_drng_atomic_seed_drng(drng);
+
+	if (start)
+		trace_lrng_drng_seed(drng, drng->node, lock_wait,
+				     ktime_get_ns() - start);
 }
 
-static void lrng_drng_seed_work_one(struct lrng_drng *drng, u32 node)
+/*
+ * Seed the DRNG if it is not fully seeded. Return true if the seed work shall
+ * stop, i.e. when the DRNG was seeded and the available entropy does not
+ * suffice to seed another DRNG right away.
+ */
+static bool lrng_drng_seed_work_one(struct lrng_drng *drng, u32 node,
+				    bool force, bool backoff)
 {
+	if (!drng || drng->fully_seeded)
+		return false;
+
+	drng->force_reseed |= force;
 	pr_debug("reseed triggered by system events for DRNG on NUMA node %d\n",
 		 node);
-	lrng_drng_seed(drng);
-	if (drng->fully_seeded) {
-		/* Prevent reseed storm */
-		drng->last_seeded += node * 100 * HZ;
-	}
+	/* The reseed scheduler spreads the following reseeds of the DRNGs */
+	lrng_drng_seed(drng, false, backoff);
+
+	return (!drng->fully_seeded ||
+		lrng_avail_entropy() < lrng_get_seed_entropy_osr(false));
 }
 
 /*
  * DRNG reseed trigger: Kernel thread handler triggered by the schedule_work()
  */
-static void __lrng_drng_seed_work(bool force)
+static void __lrng_drng_seed_work(bool force, bool backoff)
 {
 	struct lrng_drng **lrng_drng;
 	u32 node;
@@ -374,50 +1096,89 @@ static void __lrng_drng_seed_work(bool force)
 
 		atomic->force_reseed |= force;
 		spin_lock_irqsave(&atomic->spin_lock, flags);
-		lrng_drng_seed_es_nolock(atomic, false, "atomic");
+		lrng_drng_seed_es_nolock(atomic, false, false, false, "atomic");
 		spin_unlock_irqrestore(&atomic->spin_lock, flags);
 
 		return;
 	}
 
+	/*
+	 * Seed the DRNGs which are not fully seeded one after the other as long
+	 * as the entropy suffices instead of one DRNG per invocation.
+	 */
 	lrng_drng = lrng_drng_instances();
 	if (lrng_drng) {
 		for_each_online_node(node) {
-			struct lrng_drng *drng = lrng_drng[node];
-
-			if (drng && !drng->fully_seeded) {
-				drng->force_reseed |= force;
-				lrng_drng_seed_work_one(drng, node);
+			if (lrng_drng_seed_work_one(lrng_drng[node], node,
+						    force, backoff))
 				return;
-			}
-		}
-	} else {
-		if (!lrng_drng_init.fully_seeded) {
-			lrng_drng_init.force_reseed |= force;
-			lrng_drng_seed_work_one(&lrng_drng_init, 0);
-			return;
 		}
+	} else if (lrng_drng_seed_work_one(&lrng_drng_init, 0, force,
+					   backoff)) {
+		return;
 	}
 
-	if (!lrng_drng_pr.fully_seeded) {
-		lrng_drng_pr.force_reseed |= force;
-		lrng_drng_seed_work_one(&lrng_drng_pr, 0);
+	lrng_drng = lrng_drng_pr_instances();
+	if (lrng_drng) {
+		for_each_online_node(node) {
+			if (lrng_drng_seed_work_one(lrng_drng[node], node,
+						    force, backoff))
+				return;
+		}
+	} else if (lrng_drng_seed_work_one(&lrng_drng_pr, 0, force,
+					   backoff)) {
 		return;
 	}
 
 	lrng_pool_all_numa_nodes_seeded(true);
 }
 
-void lrng_drng_seed_work(struct work_struct *dummy)
+/*
+ * Seed the DRNGs - caller must hold the pool lock. When invoked as work item,
+ * the emergency seeding may wait for new entropy. The direct invocation
+ * without work item is performed during boot and must not wait.
+ */
+void lrng_drng_seed_work(struct work_struct *work)
 {
-	__lrng_drng_seed_work(false);
+	__lrng_drng_seed_work(false, !!work);
 
 	/* Allow the seeding operation to be called again */
 	lrng_pool_unlock();
 }
 
-/* Force all DRNGs to reseed before next generation */
+/*
+ * Force all DRNGs to reseed before next generation by advancing the reseed
+ * epoch, e.g. after a VM fork. As a DRNG with a stale epoch waits for its
+ * reseed, this is reserved for events not triggered by unprivileged users,
+ * see lrng_drng_force_reseed_nodes.
+ */
 void lrng_drng_force_reseed(void)
+{
+	/*
+	 * If the initial DRNG is over the reseed threshold, additionally force
+	 * its reseed as this is the fallback for all. It must be kept seeded
+	 * before all others to keep the LRNG operational.
+	 */
+	if (atomic_read_u32(&lrng_drng_init.requests_since_fully_seeded) >
+	    LRNG_DRNG_RESEED_THRESH) {
+		lrng_drng_init.force_reseed = lrng_drng_init.fully_seeded;
+		pr_debug("force reseed of initial DRNG\n");
+	}
+
+	/* All DRNGs reseed lazily when they are used next */
+	atomic_inc(&lrng_drng_reseed_epoch);
+	pr_debug("force reseed of all DRNGs\n");
+}
+EXPORT_SYMBOL(lrng_drng_force_reseed);
+
+/*
+ * Force the initial and per-NUMA node DRNGs to reseed before their next
+ * generation without advancing the reseed epoch. This serves requests any
+ * unprivileged user can issue, e.g. writing data into /dev/random. The DRNGs
+ * reseed when the caller obtains the seeding lock without waiting and the
+ * DRNGs seeded from them follow their reseed.
+ */
+void lrng_drng_force_reseed_nodes(void)
 {
 	struct lrng_drng **lrng_drng = lrng_drng_instances();
 	u32 node;
@@ -435,7 +1196,7 @@ void lrng_drng_force_reseed(void)
 		return;
 	}
 	for_each_online_node(node) {
-		struct lrng_drng *drng = lrng_drng[node];
+		struct lrng_drng *drng = READ_ONCE(lrng_drng[node]);
 
 		if (!drng)
 			continue;
@@ -443,34 +1204,349 @@ void lrng_drng_force_reseed(void)
 		drng->force_reseed = drng->fully_seeded;
 		pr_debug("force reseed of DRNG on node %u\n", node);
 	}
-	lrng_drng_atomic_force_reseed();
 }
-EXPORT_SYMBOL(lrng_drng_force_reseed);
+EXPORT_SYMBOL(lrng_drng_force_reseed_nodes);
 
-static bool lrng_drng_must_reseed(struct lrng_drng *drng)
+/*
+ * Reseed one DRNG for which a background reseed was requested. The entropy
+ * sources are harvested without holding the DRNG lock such that callers can
+ * continue to generate random numbers. The DRNG lock is only taken to inject
+ * the collected seed.
+ */
+static void lrng_drng_seed_async_one(struct lrng_drng *drng)
 {
-	return (atomic_dec_and_test(&drng->requests) ||
-		drng->force_reseed ||
-		time_after(jiffies,
-			   drng->last_seeded + lrng_drng_reseed_max_time * HZ));
+	bool shared;
+
+	if (!atomic_xchg(&drng->async_reseed, 0))
+		return;
+
+	/* Leave the reseed to the next caller if it cannot be started now */
+	if (!lrng_drng_seed_trylock(drng, &shared)) {
+		drng->force_reseed = true;
+		return;
+	}
+
+	lrng_drng_seed(drng, true, false);
+	lrng_drng_seed_unlock(drng, shared);
+}
+
+/* Background reseed handler for all DRNGs requesting a reseed */
+static void lrng_drng_seed_async_work(struct work_struct *unused)
+{
+	struct lrng_drng **lrng_drng = lrng_drng_instances();
+	u32 node;
+
+	if (lrng_drng) {
+		for_each_online_node(node) {
+			struct lrng_drng *drng = READ_ONCE(lrng_drng[node]);
+
+			if (drng)
+				lrng_drng_seed_async_one(drng);
+		}
+	}
+
+	lrng_drng_seed_async_one(&lrng_drng_init);
 }
 
+static DECLARE_WORK(lrng_drng_seed_async_work_struct,
+		    lrng_drng_seed_async_work);
+
 /*
- * lrng_drng_get() - Get random data out of the DRNG which is reseeded
- * frequently.
+ * Did the background reseed requested for the DRNG fall behind such that the
+ * DRNG generated max_wo_reseed times without being fully reseeded? This is
+ * checked with every generate operation as the reseed triggers do not fire
+ * again while the background reseed is pending.
+ */
+static bool lrng_drng_seed_async_behind(struct lrng_drng *drng)
+{
+	u32 requests;
+
+	if (!IS_ENABLED(CONFIG_LRNG_DRNG_ASYNC_RESEED) ||
+	    !atomic_read(&drng->async_reseed))
+		return false;
+
+	requests = atomic_read_u32(&drng->requests_since_fully_seeded) +
+		   (u32)(LRNG_DRNG_RESEED_THRESH - atomic_read(&drng->requests));
+	if (requests < max_wo_reseed)
+		return false;
+
+	pr_debug("background reseed falls behind, reseed DRNG synchronously\n");
+	return true;
+}
+
+/*
+ * Request a reseed of the DRNG by the background worker. Return true if the
+ * caller can continue generating random numbers without reseeding the DRNG
+ * itself.
+ *
+ * The initial and emergency seeding of a DRNG that is not fully seeded as
+ * well as a forced reseed are performed synchronously. When the DRNG
+ * generated max_wo_reseed times without being fully reseeded because the
+ * background reseed falls behind, the caller reseeds the DRNG.
+ */
+static bool lrng_drng_seed_async(struct lrng_drng *drng)
+{
+	if (!IS_ENABLED(CONFIG_LRNG_DRNG_ASYNC_RESEED))
+		return false;
+
+	if (!drng->fully_seeded || drng->force_reseed ||
+	    lrng_drng_epoch_stale(drng) || lrng_drng_seed_async_behind(drng))
+		return false;
+
+	atomic_set(&drng->async_reseed, 1);
+	queue_work(system_unbound_wq, &lrng_drng_seed_async_work_struct);
+
+	return true;
+}
+
+/*
+ * lrng_drng_node_get_atomic() - Get random data out of the DRNG of the
+ * current NUMA node from atomic context.
+ *
+ * The DRNG is only used with CONFIG_LRNG_DRNG_NODE_ATOMIC when it operates
+ * with a DRNG that never sleeps and when it is fully seeded. The latter also
+ * implies that no data is generated between the injections of an emergency
+ * seeding. As an atomic caller cannot reseed the DRNG, a reseed is requested
+ * when it is due and the caller must use the atomic DRNG until the DRNG is
+ * reseeded.
  *
- * @drng: DRNG instance
  * @outbuf: buffer for storing random data
- * @outbuflen: length of outbuf
+ * @outbuflen: length of outbuf - at most LRNG_DRNG_MAX_REQSIZE bytes are
+ *	       generated
  *
  * Return:
- * * < 0 in error case (DRNG generation or update failed)
+ * * -EOPNOTSUPP if the DRNG cannot be used from atomic context
+ * * < 0 in error case (DRNG generation failed)
  * * >=0 returning the returned number of bytes
  */
-int lrng_drng_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen)
+int lrng_drng_node_get_atomic(u8 *outbuf, u32 outbuflen)
+{
+	struct lrng_drng *drng;
+	unsigned long flags;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_LRNG_DRNG_NODE_ATOMIC) || !lrng_get_available())
+		return -EOPNOTSUPP;
+
+	drng = lrng_drng_node_instance();
+	outbuflen = min_t(u32, outbuflen, LRNG_DRNG_MAX_REQSIZE);
+
+	spin_lock_irqsave(&drng->spin_lock, flags);
+
+	if (!lrng_drng_is_atomic(drng) || !drng->fully_seeded ||
+	    drng->force_reseed || lrng_drng_epoch_stale(drng)) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	if (lrng_drng_must_reseed(drng) || lrng_drng_seed_async_behind(drng)) {
+		/* Reseed by the next sleeping caller if no background reseed */
+		if (!lrng_drng_seed_async(drng))
+			drng->force_reseed = true;
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	ret = drng->drng_cb->drng_generate(drng->drng, outbuf, outbuflen);
+
+out:
+	spin_unlock_irqrestore(&drng->spin_lock, flags);
+	return ret;
+}
+
+/*
+ * Prediction resistance DRNG: Every output must be backed by fresh entropy.
+ * Callers queue their requests first in first out. The caller holding the
+ * DRNG lock (re)seeds the DRNG once and serves as many queued requests as the
+ * received entropy allows, including those of other callers. All other
+ * callers sleep on the DRNG lock and find their request completed or serve
+ * the queue in turn. A request not completed with one seed is queued again at
+ * the end to let all requests progress. When the seed did not deliver entropy,
+ * all queued requests are completed with the data generated so far, i.e. the
+ * callers receive a short read. A caller which cannot take the seeding lock
+ * waits until its request is completed or an entropy source reports new
+ * entropy before retrying. The completion of a request is published with
+ * release semantics such that its owner observes the generated data and the
+ * return code.
+ */
+struct lrng_drng_pr_req {
+	struct list_head list;
+	u8 *outbuf;
+	u32 outbuflen;
+	u32 processed;
+	int ret;
+	bool done;
+};
+
+static struct lrng_drng_pr_req *lrng_drng_pr_dequeue(struct lrng_drng *drng)
+{
+	struct lrng_drng_pr_req *req;
+
+	spin_lock(&drng->spin_lock);
+	req = list_first_entry_or_null(&drng->pr_queue,
+				       struct lrng_drng_pr_req, list);
+	if (req)
+		list_del(&req->list);
+	spin_unlock(&drng->spin_lock);
+
+	return req;
+}
+
+static void lrng_drng_pr_enqueue(struct lrng_drng *drng,
+				 struct lrng_drng_pr_req *req)
+{
+	spin_lock(&drng->spin_lock);
+	list_add_tail(&req->list, &drng->pr_queue);
+	spin_unlock(&drng->spin_lock);
+}
+
+/* Complete the request - counterpart to smp_load_acquire of its owner */
+static void lrng_drng_pr_done(struct lrng_drng_pr_req *req)
+{
+	smp_store_release(&req->done, true);
+
+	/* Wake the owner if it waits in lrng_drng_pr_wait */
+	if (wq_has_sleeper(&lrng_drng_es_wait))
+		wake_up_interruptible_all(&lrng_drng_es_wait);
+}
+
+/*
+ * Wait until the request is completed by another caller, an entropy source
+ * reports new entropy, a signal is received or the timeout expires.
+ */
+static void lrng_drng_pr_wait(struct lrng_drng_pr_req *req)
+{
+	int events = atomic_read(&lrng_drng_es_events);
+
+	wait_event_interruptible_timeout(lrng_drng_es_wait,
+		smp_load_acquire(&req->done) ||
+		atomic_read(&lrng_drng_es_events) != events,
+		msecs_to_jiffies(LRNG_DRNG_EMERGENCY_SEED_MAX_WAIT_MS));
+}
+
+/*
+ * Remove the request of a caller which stops waiting for it from the queue.
+ * Requests are only in flight while a caller serves the queue holding the
+ * DRNG lock. Thus, the request is either completed or queued.
+ */
+static void lrng_drng_pr_cancel(struct lrng_drng *drng,
+				struct lrng_drng_pr_req *req)
+{
+	mutex_lock(&drng->lock);
+	spin_lock(&drng->spin_lock);
+	if (!req->done)
+		list_del(&req->list);
+	spin_unlock(&drng->spin_lock);
+	mutex_unlock(&drng->lock);
+}
+
+/*
+ * Serve the queued requests with one (re)seed of the PR DRNG - caller must
+ * hold the DRNG lock and the seeding lock if the DRNG is not fully seeded.
+ */
+static void lrng_drng_pr_serve(struct lrng_drng *drng)
+{
+	struct lrng_drng_pr_req *req;
+	/* Do not produce more than DRNG security strength */
+	u32 budget = lrng_security_strength();
+
+	/* If async reseed did not deliver entropy, try now */
+	if (!drng->fully_seeded) {
+		u32 coll_ent_bits = lrng_drng_seed_es_nolock(drng, true, false,
+							     false, "regular");
+
+		/* Produce no more data than received entropy */
+		budget = min_t(u32, budget, coll_ent_bits);
+	}
+	budget >>= 3;
+
+	/* If no new entropy was received, stop all requests now. */
+	if (!budget) {
+		while ((req = lrng_drng_pr_dequeue(drng)))
+			lrng_drng_pr_done(req);
+		return;
+	}
+
+	while (budget && (req = lrng_drng_pr_dequeue(drng))) {
+		u32 todo = min3(req->outbuflen - req->processed, budget,
+				lrng_drng_reqsize(drng));
+		int ret = drng->drng_cb->drng_generate(drng->drng,
+						       req->outbuf +
+						       req->processed, todo);
+
+		if (ret <= 0) {
+			pr_warn("getting random data from DRNG failed (%d)\n",
+				ret);
+			req->ret = -EFAULT;
+			lrng_drng_pr_done(req);
+			continue;
+		}
+
+		req->processed += ret;
+		budget -= ret;
+
+		if (req->processed < req->outbuflen)
+			lrng_drng_pr_enqueue(drng, req);
+		else
+			lrng_drng_pr_done(req);
+	}
+
+	/* Force the async reseed for PR DRNG */
+	lrng_unset_fully_seeded(drng);
+}
+
+static int lrng_drng_pr_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen)
+{
+	struct lrng_drng_pr_req req = {
+		.outbuf = outbuf,
+		.outbuflen = outbuflen,
+	};
+
+	lrng_drng_pr_enqueue(drng, &req);
+
+	while (!smp_load_acquire(&req.done)) {
+		/*
+		 * The seeding lock must be taken before the DRNG lock. The
+		 * seeding of the PR DRNG is admitted like the reseed of any
+		 * other DRNG: it is only started concurrently to other reseeds
+		 * when the available entropy suffices for all of them.
+		 * Otherwise, the caller waits and retries.
+		 */
+		bool seed = !drng->fully_seeded, shared = false;
+
+		if (seed && !lrng_drng_seed_trylock(drng, &shared)) {
+			lrng_drng_pr_wait(&req);
+			if (signal_pending(current)) {
+				lrng_drng_pr_cancel(drng, &req);
+				if (!req.done && !req.processed)
+					return -ERESTARTSYS;
+				break;
+			}
+			continue;
+		}
+
+		mutex_lock(&drng->lock);
+
+		/* Seeding lock required if DRNG lost its seed in the meantime */
+		if (!req.done && (seed || drng->fully_seeded))
+			lrng_drng_pr_serve(drng);
+
+		mutex_unlock(&drng->lock);
+		if (seed)
+			lrng_drng_seed_unlock(drng, shared);
+
+		if (!smp_load_acquire(&req.done))
+			cond_resched();
+	}
+
+	return req.ret ? req.ret : req.processed;
+}
+
+static int __lrng_drng_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen,
+			   u32 *epoch)
 {
+	unsigned long flags;
 	u32 processed = 0;
-	bool pr = (drng == &lrng_drng_pr) ? true : false;
 
 	if (!outbuf || !outbuflen)
 		return 0;
@@ -480,58 +1556,53 @@ int lrng_drng_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen)
 
 	outbuflen = min_t(size_t, outbuflen, INT_MAX);
 
+	if (lrng_drng_is_pr(drng)) {
+		/* Every PR request is seeded after the epoch was read */
+		if (epoch)
+			*epoch = READ_ONCE(drng->seed_epoch);
+		return lrng_drng_pr_get(drng, outbuf, outbuflen);
+	}
+
 	/* If DRNG operated without proper reseed for too long, block LRNG */
 	BUILD_BUG_ON(LRNG_DRNG_MAX_WITHOUT_RESEED < LRNG_DRNG_RESEED_THRESH);
 	if (atomic_read_u32(&drng->requests_since_fully_seeded) > max_wo_reseed)
 		lrng_unset_fully_seeded(drng);
 
 	while (outbuflen) {
-		u32 todo = min_t(u32, outbuflen, LRNG_DRNG_MAX_REQSIZE);
+		u32 todo;
 		int ret;
 
 		/* In normal operation, check whether to reseed */
-		if (!pr && lrng_drng_must_reseed(drng)) {
-			if (!lrng_pool_trylock()) {
-				drng->force_reseed = true;
+		if ((lrng_drng_must_reseed(drng) ||
+		     lrng_drng_seed_async_behind(drng)) &&
+		    !lrng_drng_seed_async(drng)) {
+			bool shared;
+
+			/* A stale epoch must not be used to generate data */
+			if (lrng_drng_seed_trylock(drng, &shared) ||
+			    lrng_drng_seed_lock_stale(drng, &shared)) {
+				lrng_drng_seed(drng, false, false);
+				lrng_drng_seed_unlock(drng, shared);
 			} else {
-				lrng_drng_seed(drng);
-				lrng_pool_unlock();
+				drng->force_reseed = true;
 			}
 		}
 
 		mutex_lock(&drng->lock);
 
-		if (pr) {
-			/* If async reseed did not deliver entropy, try now */
-			if (!drng->fully_seeded) {
-				u32 coll_ent_bits;
-
-				/* If we cannot get the pool lock, try again. */
-				if (!lrng_pool_trylock()) {
-					mutex_unlock(&drng->lock);
-					continue;
-				}
+		todo = min_t(u32, outbuflen, lrng_drng_reqsize(drng));
+		/* Bound the time with interrupts disabled */
+		if (lrng_drng_is_atomic(drng))
+			todo = min_t(u32, todo, LRNG_DRNG_ATOMIC_REQSIZE);
 
-				coll_ent_bits = lrng_drng_seed_es_nolock(
-							drng, true, "regular");
-
-				lrng_pool_unlock();
-
-				/* If no new entropy was received, stop now. */
-				if (!coll_ent_bits) {
-					mutex_unlock(&drng->lock);
-					goto out;
-				}
-
-				/* Produce no more data than received entropy */
-				todo = min_t(u32, todo, coll_ent_bits >> 3);
-			}
-
-			/* Do not produce more than DRNG security strength */
-			todo = min_t(u32, todo, lrng_security_strength() >> 3);
-		}
+		lrng_drng_state_lock(drng, &flags);
 		ret = drng->drng_cb->drng_generate(drng->drng,
 						   outbuf + processed, todo);
+		lrng_drng_state_unlock(drng, &flags);
+
+		/* The first generated chunk uses the oldest seed */
+		if (epoch && !processed)
+			*epoch = READ_ONCE(drng->seed_epoch);
 
 		mutex_unlock(&drng->lock);
 		if (ret <= 0) {
@@ -541,36 +1612,115 @@ int lrng_drng_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen)
 		}
 		processed += ret;
 		outbuflen -= ret;
-
-		if (pr) {
-			/* Force the async reseed for PR DRNG */
-			lrng_unset_fully_seeded(drng);
-			if (outbuflen)
-				cond_resched();
-		}
 	}
 
-out:
 	return processed;
 }
 
+/*
+ * lrng_drng_get() - Get random data out of the DRNG which is reseeded
+ * frequently.
+ *
+ * @drng: DRNG instance
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf
+ *
+ * Return:
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen)
+{
+	return __lrng_drng_get(drng, outbuf, outbuflen, NULL);
+}
+
+/*
+ * lrng_drng_get_epoch() - Get random data out of the DRNG as lrng_drng_get,
+ * e.g. to seed another DRNG.
+ *
+ * @drng: DRNG instance
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf
+ * @epoch: reseed epoch of the seed the random data is generated with, read
+ *	   together with the generate operation while holding the DRNG lock
+ *
+ * Return:
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_get_epoch(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen,
+			u32 *epoch)
+{
+	return __lrng_drng_get(drng, outbuf, outbuflen, epoch);
+}
+
+/*
+ * lrng_drng_get_noreseed() - Get random data out of the DRNG without
+ * reseeding it, e.g. to seed another DRNG while the caller holds the seeding
+ * lock of the DRNG.
+ *
+ * @drng: DRNG instance
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf - at most lrng_drng_reqsize() bytes
+ * @epoch: reseed epoch of the seed the random data is generated with
+ *
+ * Return:
+ * * < 0 in error case (DRNG generation failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_get_noreseed(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen,
+			   u32 *epoch)
+{
+	unsigned long flags;
+	int ret;
+
+	mutex_lock(&drng->lock);
+	lrng_drng_state_lock(drng, &flags);
+	ret = drng->drng_cb->drng_generate(drng->drng, outbuf, outbuflen);
+	lrng_drng_state_unlock(drng, &flags);
+	*epoch = READ_ONCE(drng->seed_epoch);
+	mutex_unlock(&drng->lock);
+
+	return ret;
+}
+
 int lrng_drng_get_sleep(u8 *outbuf, u32 outbuflen, bool pr)
 {
 	struct lrng_drng **lrng_drng = lrng_drng_instances();
-	struct lrng_drng *drng = &lrng_drng_init;
+	struct lrng_drng **lrng_drng_pr_nodes = lrng_drng_pr_instances();
+	struct lrng_drng *drng = &lrng_drng_init, *node_drng = NULL;
 	int ret, node = numa_node_id();
 
 	might_sleep();
 
+	/* The DRNG of the node may go online or offline concurrently */
+	if (pr && lrng_drng_pr_nodes)
+		node_drng = READ_ONCE(lrng_drng_pr_nodes[node]);
+	else if (!pr && lrng_drng)
+		node_drng = READ_ONCE(lrng_drng[node]);
+
 	if (pr)
-		drng = &lrng_drng_pr;
-	else if (lrng_drng && lrng_drng[node] && lrng_drng[node]->fully_seeded)
-		drng = lrng_drng[node];
+		drng = node_drng ?: &lrng_drng_pr;
+	else if (node_drng && node_drng->fully_seeded)
+		drng = node_drng;
 
 	ret = lrng_drng_initalize();
 	if (ret)
 		return ret;
 
+	/*
+	 * Use the bulk or per-CPU DRNG seeded from the selected DRNG, if
+	 * available.
+	 */
+	if (!pr && drng->fully_seeded) {
+		if (outbuflen >= LRNG_DRNG_BULK_MIN_REQSIZE)
+			ret = lrng_drng_bulk_get(drng, outbuf, outbuflen);
+		else
+			ret = lrng_drng_percpu_get(drng, outbuf, outbuflen);
+		if (ret != -EOPNOTSUPP)
+			return ret;
+	}
+
 	return lrng_drng_get(drng, outbuf, outbuflen);
 }
 
@@ -580,28 +1730,37 @@ static void _lrng_reset(struct work_struct *work)
 	struct lrng_drng **lrng_drng = lrng_drng_instances();
 
 	if (!lrng_drng) {
-		mutex_lock(&lrng_drng_init.lock);
-		lrng_drng_reset(&lrng_drng_init);
-		mutex_unlock(&lrng_drng_init.lock);
+		lrng_drng_lock_reset(&lrng_drng_init);
 	} else {
 		u32 node;
 
 		for_each_online_node(node) {
 			struct lrng_drng *drng = lrng_drng[node];
 
-			if (!drng)
-				continue;
-			mutex_lock(&drng->lock);
-			lrng_drng_reset(drng);
-			mutex_unlock(&drng->lock);
+			if (drng)
+				lrng_drng_lock_reset(drng);
 		}
 	}
 
-	mutex_lock(&lrng_drng_pr.lock);
-	lrng_drng_reset(&lrng_drng_pr);
-	mutex_unlock(&lrng_drng_pr.lock);
+	lrng_drng = lrng_drng_pr_instances();
+	if (!lrng_drng) {
+		lrng_drng_lock_reset(&lrng_drng_pr);
+	} else {
+		u32 node;
+
+		for_each_online_node(node) {
+			struct lrng_drng *drng = lrng_drng[node];
+
+			if (drng)
+				lrng_drng_lock_reset(drng);
+		}
+	}
 
+	lrng_drng_percpu_reset();
+	lrng_drng_bulk_reset();
 	lrng_drng_atomic_reset();
+	/* Invalidate the DRNGs without reset operation */
+	atomic_inc(&lrng_drng_reseed_epoch);
 	lrng_set_entropy_thresh(LRNG_INIT_ENTROPY_BITS);
 
 	lrng_reset_state();
@@ -622,7 +1781,7 @@ void lrng_force_fully_seeded(void)
 		return;
 
 	lrng_pool_lock();
-	__lrng_drng_seed_work(true);
+	__lrng_drng_seed_work(true, false);
 	lrng_pool_unlock();
 }
 
@@ -698,7 +1857,7 @@ ssize_t lrng_get_seed(u64 *buf, size_t nbytes, unsigned int flags)
 		lrng_fill_seed_buffer(eb,
 			lrng_get_seed_entropy_osr(flags &
 						  LRNG_GET_SEED_FULLY_SEEDED),
-						  false);
+						  false, NUMA_NO_NODE);
 		collected_bits = lrng_entropy_rate_eb(eb);
 
 		/* Break the collection loop if we got entropy, ... */
@@ -7,6 +7,7 @@
 #define _LRNG_DRNG_H
 
 #include <linux/mutex.h>
+#include <linux/numa.h>
 #include <linux/spinlock.h>
 #include <linux/workqueue.h>
 
@@ -25,17 +26,41 @@ struct lrng_drng {
 	const struct lrng_drng_cb *drng_cb;	/* DRNG callbacks */
 	const struct lrng_hash_cb *hash_cb;	/* Hash callbacks */
 	atomic_t requests;			/* Number of DRNG requests */
+	u32 requests_gen;			/* Generation of requests */
 	atomic_t requests_since_fully_seeded;	/* Number DRNG requests since
 						 * last fully seeded
 						 */
 	unsigned long last_seeded;		/* Last time it was seeded */
+	unsigned long reseed_deadline;		/* Next time-based reseed */
 	bool fully_seeded;			/* Is DRNG fully seeded? */
 	bool force_reseed;			/* Force a reseed */
+	u32 seed_epoch;				/* Reseed epoch of last seeding */
+	atomic_t async_reseed;			/* Background reseed requested */
+	atomic_t seeding;			/* Reseed in progress */
+	int node;				/* NUMA node of per-node DRNG */
+	bool pr;				/* Prediction resistance DRNG */
+
+	/*
+	 * Entropy allocation - only changed by the reseed of the DRNG, read by
+	 * the reseeds of the other DRNGs
+	 */
+	unsigned long es_vtime;			/* Weighted entropy consumption */
+	unsigned long es_harvested;		/* Last harvest of entropy */
+	bool es_starved;			/* Last harvest was starved */
+	atomic_t es_starvations;		/* Number of starved harvests */
+	atomic_t es_deferrals;			/* Number of deferred harvests */
+	atomic_t es_harvests;			/* Number of entropy harvests */
+
+	/* Seeding tree */
+	struct lrng_drng *seed_root;		/* DRNG seeding this DRNG */
+	u32 seed_root_harvests;			/* Root harvests at last seeding */
+	atomic_t seed_root_seedings;		/* Number of seedings from root */
 
 	rwlock_t hash_lock;			/* Lock hash_cb replacement */
 	/* Lock write operations on DRNG state, DRNG replacement of drng_cb */
 	struct mutex lock;			/* Non-atomic DRNG operation */
 	spinlock_t spin_lock;			/* Atomic DRNG operation */
+	struct list_head pr_queue;		/* Queued PR requests */
 };
 
 #define LRNG_DRNG_STATE_INIT(x, d, h, d_cb, h_cb) \
@@ -44,11 +69,27 @@ struct lrng_drng {
 	.drng_cb			= d_cb, \
 	.hash_cb			= h_cb, \
 	.requests			= ATOMIC_INIT(LRNG_DRNG_RESEED_THRESH),\
+	.requests_gen			= 0, \
 	.requests_since_fully_seeded	= ATOMIC_INIT(0), \
 	.last_seeded			= 0, \
+	.reseed_deadline		= 0, \
 	.fully_seeded			= false, \
 	.force_reseed			= true, \
-	.hash_lock			= __RW_LOCK_UNLOCKED(x.hash_lock)
+	.seed_epoch			= 0, \
+	.async_reseed			= ATOMIC_INIT(0), \
+	.seeding			= ATOMIC_INIT(0), \
+	.node				= NUMA_NO_NODE, \
+	.es_vtime			= 0, \
+	.es_harvested			= 0, \
+	.es_starved			= false, \
+	.es_starvations			= ATOMIC_INIT(0), \
+	.es_deferrals			= ATOMIC_INIT(0), \
+	.es_harvests			= ATOMIC_INIT(0), \
+	.seed_root			= NULL, \
+	.seed_root_harvests		= 0, \
+	.seed_root_seedings		= ATOMIC_INIT(0), \
+	.hash_lock			= __RW_LOCK_UNLOCKED(x.hash_lock), \
+	.pr_queue			= LIST_HEAD_INIT(x.pr_queue)
 
 struct lrng_drng *lrng_drng_init_instance(void);
 struct lrng_drng *lrng_drng_pr_instance(void);
@@ -56,21 +97,40 @@ struct lrng_drng *lrng_drng_node_instance(void);
 
 void lrng_reset(void);
 int lrng_drng_alloc_common(struct lrng_drng *drng,
-			   const struct lrng_drng_cb *crypto_cb);
+			   const struct lrng_drng_cb *crypto_cb, int node);
 int lrng_drng_initalize(void);
 bool lrng_sp80090c_compliant(void);
 bool lrng_get_available(void);
 void lrng_drng_reset(struct lrng_drng *drng);
+void lrng_drng_lock_reset(struct lrng_drng *drng);
+bool lrng_drng_requests_dec(struct lrng_drng *drng);
+u32 lrng_drng_reqsize(struct lrng_drng *drng);
+void lrng_drng_state_lock(struct lrng_drng *drng, unsigned long *flags);
+void lrng_drng_state_unlock(struct lrng_drng *drng, unsigned long *flags);
 void lrng_drng_inject(struct lrng_drng *drng, const u8 *inbuf, u32 inbuflen,
 		      bool fully_seeded, const char *drng_type);
 int lrng_drng_get(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen);
+int lrng_drng_get_epoch(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen,
+			u32 *epoch);
+int lrng_drng_get_noreseed(struct lrng_drng *drng, u8 *outbuf, u32 outbuflen,
+			   u32 *epoch);
+int lrng_drng_node_get_atomic(u8 *outbuf, u32 outbuflen);
 int lrng_drng_sleep_while_nonoperational(int nonblock);
 int lrng_drng_sleep_while_non_min_seeded(void);
 int lrng_drng_get_sleep(u8 *outbuf, u32 outbuflen, bool pr);
-void lrng_drng_seed_work(struct work_struct *dummy);
+void lrng_drng_seed_work(struct work_struct *work);
 void lrng_drng_force_reseed(void);
+void lrng_drng_force_reseed_nodes(void);
+u32 lrng_drng_epoch(void);
+void lrng_drng_es_notify(void);
 void lrng_force_fully_seeded(void);
 
+/* Was a reseed of all DRNGs forced since the DRNG was seeded? */
+static inline bool lrng_drng_epoch_stale(struct lrng_drng *drng)
+{
+	return READ_ONCE(drng->seed_epoch) != lrng_drng_epoch();
+}
+
 static inline u32 lrng_compress_osr(void)
 {
 	return lrng_sp80090c_compliant() ? LRNG_OVERSAMPLE_ES_BITS : 0;
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause
+/*
+ * LRNG per-CPU DRNG instances
+ *
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/lrng.h>
+#include <linux/percpu.h>
+
+#include "lrng_drng_child.h"
+#include "lrng_drng_percpu.h"
+
+/*
+ * Per-CPU DRNG instance serving the regular (sleeping) random number
+ * generation. It is a child DRNG seeded from the DRNG that would serve the
+ * caller without the per-CPU instance (the per-NUMA node DRNG or the initial
+ * DRNG). The mutex lock of the per-CPU DRNG is only contended when a caller
+ * is migrated to another CPU while generating random numbers.
+ */
+static DEFINE_PER_CPU(struct lrng_drng_child *, lrng_drng_percpu) = NULL;
+
+struct lrng_drng *lrng_drng_percpu_instance(int cpu)
+{
+	struct lrng_drng_child *child = READ_ONCE(per_cpu(lrng_drng_percpu,
+							  cpu));
+
+	return child ? &child->drng : NULL;
+}
+
+void lrng_drng_percpu_reset(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct lrng_drng_child *child =
+			READ_ONCE(per_cpu(lrng_drng_percpu, cpu));
+
+		if (child)
+			lrng_drng_child_reset(child);
+	}
+}
+
+/*
+ * lrng_drng_percpu_get() - Get random data out of the per-CPU DRNG
+ *
+ * @parent: DRNG instance used to seed the per-CPU DRNG
+ * @outbuf: buffer for storing random data
+ * @outbuflen: length of outbuf
+ *
+ * Return:
+ * * -EOPNOTSUPP if no per-CPU DRNG is available
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+int lrng_drng_percpu_get(struct lrng_drng *parent, u8 *outbuf, u32 outbuflen)
+{
+	struct lrng_drng_child *child;
+	int cpu = raw_smp_processor_id();
+
+	/* Migration after obtaining the instance is harmless */
+	child = READ_ONCE(per_cpu(lrng_drng_percpu, cpu));
+	if (!child) {
+		child = lrng_drng_child_alloc(per_cpu_ptr(&lrng_drng_percpu,
+							  cpu),
+					      cpu_to_node(cpu));
+		if (!child)
+			return -EOPNOTSUPP;
+		pr_debug("DRNG for CPU %d allocated\n", cpu);
+	}
+
+	return lrng_drng_child_get(child, parent, outbuf, outbuflen);
+}
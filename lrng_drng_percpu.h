@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/*
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#ifndef _LRNG_DRNG_PERCPU_H
+#define _LRNG_DRNG_PERCPU_H
+
+#include "lrng_drng_mgr.h"
+
+#ifdef CONFIG_LRNG_DRNG_PERCPU
+int lrng_drng_percpu_get(struct lrng_drng *parent, u8 *outbuf, u32 outbuflen);
+struct lrng_drng *lrng_drng_percpu_instance(int cpu);
+void lrng_drng_percpu_reset(void);
+#else /* CONFIG_LRNG_DRNG_PERCPU */
+static inline int
+lrng_drng_percpu_get(struct lrng_drng *parent, u8 *outbuf, u32 outbuflen)
+{
+	return -EOPNOTSUPP;
+}
+static inline struct lrng_drng *lrng_drng_percpu_instance(int cpu)
+{
+	return NULL;
+}
+static inline void lrng_drng_percpu_reset(void) { }
+#endif /* CONFIG_LRNG_DRNG_PERCPU */
+
+#endif /* _LRNG_DRNG_PERCPU_H */
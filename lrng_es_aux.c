@@ -8,6 +8,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/lrng.h>
+#include <linux/sched.h>
 
 #include "lrng_es_aux.h"
 #include "lrng_es_mgr.h"
@@ -32,6 +33,9 @@ struct lrng_pool {
 	spinlock_t lock;
 };
 
+/* Maximum data inserted into the auxiliary pool with one lock hold */
+#define LRNG_AUX_VEC_LOCK_BYTES		4096
+
 static struct lrng_pool lrng_pool __aligned(LRNG_KCAPI_ALIGN) = {
 	.aux_entropy_bits	= ATOMIC_INIT(0),
 	.digestsize		= ATOMIC_INIT(LRNG_ATOMIC_DIGEST_SIZE),
@@ -211,6 +215,60 @@ int lrng_pool_insert_aux(const u8 *inbuf, u32 inbuflen, u32 entropy_bits)
 }
 EXPORT_SYMBOL(lrng_pool_insert_aux);
 
+/*
+ * Insert multiple data buffers into the auxiliary pool with one reseed
+ * trigger. The pool lock is held for at most LRNG_AUX_VEC_LOCK_BYTES of data
+ * to bound the time the interrupts are disabled. The entropy actually
+ * credited to the aux pool for each record is returned in the credited_bits
+ * field of that record. The credited entropy may be lower than the requested
+ * entropy due to the cap of the aux pool to the digest size of the used hash.
+ * When the insertion of a record fails, the records before remain credited.
+ * The caller must be able to sleep.
+ */
+int lrng_pool_insert_aux_vec(struct lrng_aux_rec *recs, u32 nr_recs)
+{
+	struct lrng_pool *pool = &lrng_pool;
+	unsigned long flags;
+	u32 i;
+	int ret = 0;
+
+	might_sleep();
+
+	for (i = 0; i < nr_recs && !ret; i++) {
+		struct lrng_aux_rec *rec = &recs[i];
+		const u8 *buf = rec->buf;
+		u32 len = rec->len, entropy_bits = rec->entropy_bits;
+
+		rec->credited_bits = 0;
+		do {
+			u32 todo = min_t(u32, len, LRNG_AUX_VEC_LOCK_BYTES),
+			    todo_bits = min_t(u32, entropy_bits, todo << 3),
+			    before, after;
+
+			spin_lock_irqsave(&pool->lock, flags);
+			before = atomic_read_u32(&pool->aux_entropy_bits);
+			ret = lrng_aux_pool_insert_locked(buf, todo, todo_bits);
+			after = atomic_read_u32(&pool->aux_entropy_bits);
+			spin_unlock_irqrestore(&pool->lock, flags);
+
+			if (ret)
+				break;
+			if (after > before)
+				rec->credited_bits += min_t(u32, after - before,
+							    todo_bits);
+
+			buf += todo;
+			len -= todo;
+			entropy_bits -= todo_bits;
+			cond_resched();
+		} while (len);
+	}
+
+	lrng_es_add_entropy();
+
+	return ret;
+}
+
 /************************* Get data from entropy pool *************************/
 
 /*
@@ -218,9 +276,10 @@ EXPORT_SYMBOL(lrng_pool_insert_aux);
  * Caller must hold lrng_pool.pool->lock.
  * @outbuf: buffer to store data in with size requested_bits
  * @requested_bits: Requested amount of entropy
+ * @outlen: length of the data stored in outbuf in bytes
  * @return: amount of entropy in outbuf in bits.
  */
-static u32 lrng_aux_get_pool(u8 *outbuf, u32 requested_bits)
+static u32 lrng_aux_get_pool(u8 *outbuf, u32 requested_bits, u32 *outlen)
 {
 	struct lrng_pool *pool = &lrng_pool;
 	struct shash_desc *shash = (struct shash_desc *)pool->aux_pool;
@@ -232,6 +291,7 @@ static u32 lrng_aux_get_pool(u8 *outbuf, u32 requested_bits)
 	    digestsize, digestsize_bits, requested_bits_osr;
 	u8 aux_output[LRNG_MAX_DIGESTSIZE];
 
+	*outlen = 0;
 	if (unlikely(!pool->initialized))
 		return 0;
 
@@ -285,6 +345,7 @@ static u32 lrng_aux_get_pool(u8 *outbuf, u32 requested_bits)
 		 * entropy, but we want to use them to stir the DRNG state.
 		 */
 		memcpy(outbuf, aux_output, requested_bits >> 3);
+		*outlen = requested_bits >> 3;
 	}
 
 	read_unlock_irqrestore(&drng->hash_lock, flags);
@@ -293,23 +354,27 @@ static u32 lrng_aux_get_pool(u8 *outbuf, u32 requested_bits)
 }
 
 static void lrng_aux_get_backtrack(struct entropy_buf *eb, u32 requested_bits,
-				   bool __unused)
+				   bool __unused, int node)
 {
 	struct lrng_pool *pool = &lrng_pool;
+	u8 seedrec[LRNG_SEED_RECORD_MAX_BYTES];
 	unsigned long flags;
 
 	/* Ensure aux pool extraction and backtracking op are atomic */
 	spin_lock_irqsave(&pool->lock, flags);
 
-	eb->e_bits[lrng_ext_es_aux] = lrng_aux_get_pool(eb->e[lrng_ext_es_aux],
-							requested_bits);
+	eb->e_bits[lrng_ext_es_aux] =
+		lrng_aux_get_pool(eb->e[lrng_ext_es_aux], requested_bits,
+				  &eb->e_len[lrng_ext_es_aux]);
 
 	/* Mix the extracted data back into pool for backtracking resistance */
-	if (lrng_aux_pool_insert_locked((u8 *)eb,
-					sizeof(struct entropy_buf), 0))
+	if (lrng_aux_pool_insert_locked(seedrec, lrng_seed_record(eb, seedrec),
+					0))
 		pr_warn("Backtracking resistance operation failed\n");
 
 	spin_unlock_irqrestore(&pool->lock, flags);
+
+	memzero_explicit(seedrec, sizeof(seedrec));
 }
 
 static void lrng_aux_es_state(unsigned char *buf, size_t buflen)
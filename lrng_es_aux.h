@@ -9,9 +9,18 @@
 #include "lrng_drng_mgr.h"
 #include "lrng_es_mgr_cb.h"
 
+/* One data buffer inserted with lrng_pool_insert_aux_vec */
+struct lrng_aux_rec {
+	const u8 *buf;			/* Data to be inserted */
+	u32 len;			/* Length of buf */
+	u32 entropy_bits;		/* Entropy claimed for buf */
+	u32 credited_bits;		/* Entropy credited to aux pool */
+};
+
 u32 lrng_get_digestsize(void);
 void lrng_pool_set_entropy(u32 entropy_bits);
 int lrng_pool_insert_aux(const u8 *inbuf, u32 inbuflen, u32 entropy_bits);
+int lrng_pool_insert_aux_vec(struct lrng_aux_rec *recs, u32 nr_recs);
 
 extern struct lrng_es_cb lrng_es_aux;
 
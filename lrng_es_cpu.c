@@ -9,13 +9,18 @@
 
 #include <linux/lrng.h>
 #include <crypto/hash.h>
+#include <linux/cpumask.h>
 #include <linux/module.h>
 #include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
 #include <asm/archrandom.h>
 
 #include "lrng_definitions.h"
 #include "lrng_es_aux.h"
 #include "lrng_es_cpu.h"
+#include "lrng_numa.h"
 
 /*
  * Estimated entropy of data is a 32th of LRNG_DRNG_SECURITY_STRENGTH_BITS.
@@ -34,6 +39,22 @@ module_param(cpu_entropy, uint, 0644);
 MODULE_PARM_DESC(cpu_entropy, "Entropy in bits of 256 data bits from CPU noise source (e.g. RDSEED)");
 #endif
 
+/*
+ * Number of attempts to obtain data from the CPU before one request is
+ * considered to have failed.
+ */
+#define LRNG_CPU_RETRIES		10
+
+/*
+ * Number of consecutive failed requests after which the CPU entropy source is
+ * considered to be broken and is not credited with entropy any more. A single
+ * failure, e.g. a transient RDSEED underflow, does not disable the source.
+ */
+#define LRNG_CPU_MAX_FAILURES		16
+
+static atomic_t lrng_cpu_failures_consecutive = ATOMIC_INIT(0);
+static atomic64_t lrng_cpu_failures = ATOMIC64_INIT(0);
+
 static int __init lrng_parse_trust_cpu(char *arg)
 {
 	int ret;
@@ -64,10 +85,26 @@ static u32 lrng_cpu_poolsize(void)
 	return lrng_cpu_entropylevel(lrng_security_strength());
 }
 
+/* Record a failed request of the CPU entropy source */
+static void lrng_cpu_failure(void)
+{
+	atomic64_inc(&lrng_cpu_failures);
+
+	if (atomic_inc_return(&lrng_cpu_failures_consecutive) <
+	    LRNG_CPU_MAX_FAILURES)
+		return;
+
+	if (cpu_entropy) {
+		pr_warn("CPU entropy source failed %u times in a row, disabling it\n",
+			LRNG_CPU_MAX_FAILURES);
+		cpu_entropy = 0;
+	}
+}
+
 static u32 lrng_get_cpu_data(u8 *outbuf, u32 requested_bits)
 {
 	size_t longs = 0;
-	u32 i,  req = requested_bits >> 3;
+	u32 i,  req = requested_bits >> 3, retries = 0;
 
 	/* operate on full blocks */
 	BUILD_BUG_ON(LRNG_DRNG_SECURITY_STRENGTH_BYTES % sizeof(unsigned long));
@@ -82,21 +119,47 @@ static u32 lrng_get_cpu_data(u8 *outbuf, u32 requested_bits)
 			continue;
 		longs = arch_get_random_longs((unsigned long *)(outbuf + i),
 					      req - i);
-		if (!longs) {
-			cpu_entropy = 0;
+		if (longs)
+			continue;
+
+		if (++retries > LRNG_CPU_RETRIES) {
+			lrng_cpu_failure();
 			return 0;
 		}
+		cpu_relax();
 	}
 
+	/* Avoid dirtying the shared cacheline on every successful request */
+	if (atomic_read(&lrng_cpu_failures_consecutive))
+		atomic_set(&lrng_cpu_failures_consecutive, 0);
+
 	return requested_bits;
 }
 
+/*
+ * The DRNG whose hash is used to compress the data for the given NUMA node
+ * (NUMA_NO_NODE for the node of the current CPU).
+ */
+static struct lrng_drng *lrng_cpu_drng(int node)
+{
+	struct lrng_drng **lrng_drng = lrng_drng_instances();
+
+	if (node == NUMA_NO_NODE)
+		return lrng_drng_node_instance();
+
+	/* The DRNG of the node may go online or offline concurrently */
+	if (lrng_drng)
+		return READ_ONCE(lrng_drng[node]) ?: lrng_drng_init_instance();
+
+	return lrng_drng_init_instance();
+}
+
 static u32 lrng_get_cpu_data_compress(u8 *outbuf, u32 requested_bits,
-				      u32 data_multiplier)
+				      u32 data_multiplier, int node)
 {
 	SHASH_DESC_ON_STACK(shash, NULL);
 	const struct lrng_hash_cb *hash_cb;
-	struct lrng_drng *drng = lrng_drng_node_instance();
+	struct lrng_drng *drng = lrng_cpu_drng(node);
 	unsigned long flags;
 	u32 ent_bits = 0, i, partial_bits = 0, digestsize, digestsize_bits,
 	    full_bits;
@@ -206,6 +269,227 @@ static u32 lrng_cpu_multiplier(void)
 	return data_multiplier;
 }
 
+#ifdef CONFIG_LRNG_CPU_PREFETCH
+
+/* Delay of the first retry after a failed prefetch operation */
+#define LRNG_CPU_PREFETCH_BACKOFF_MIN	(HZ / 100 ? : 1)
+/* Maximum delay of a retry after failed prefetch operations */
+#define LRNG_CPU_PREFETCH_BACKOFF_MAX	(60 * HZ)
+
+/*
+ * Per-NUMA node buffer holding compressed CPU entropy source data which is
+ * collected in the background. It allows a reseed to obtain the CPU entropy
+ * source data without having to pull and hash the oversampled CPU data.
+ */
+struct lrng_cpu_prefetch {
+	u8 data[LRNG_DRNG_INIT_SEED_SIZE_BYTES] __aligned(LRNG_KCAPI_ALIGN);
+	u32 requested_bits;		/* Request size the data is generated for */
+	u32 ent_bits;			/* Data bits in buffer, 0 if empty */
+	spinlock_t lock;		/* Protect the buffer */
+	unsigned long backoff;		/* Current retry delay in jiffies */
+	struct delayed_work work;	/* Background collection */
+	int node;			/* NUMA node owning the buffer */
+};
+
+/*
+ * Prefetch buffers for all possible NUMA nodes. Nodes without their own
+ * buffer refer to the buffer of the first online node.
+ */
+static struct lrng_cpu_prefetch **lrng_cpu_prefetch __read_mostly;
+static atomic64_t lrng_cpu_prefetch_hits = ATOMIC64_INIT(0);
+static atomic64_t lrng_cpu_prefetch_misses = ATOMIC64_INIT(0);
+
+static void lrng_cpu_prefetch_schedule(struct lrng_cpu_prefetch *pf,
+				       unsigned long delay)
+{
+	unsigned int cpu = cpumask_any_and(cpumask_of_node(pf->node),
+					   cpu_online_mask);
+
+	/* The CPU is only a hint to select a CPU of the NUMA node */
+	if (cpu >= nr_cpu_ids)
+		cpu = WORK_CPU_UNBOUND;
+	queue_delayed_work_on(cpu, system_unbound_wq, &pf->work, delay);
+}
+
+/* Fill the prefetch buffer of one NUMA node */
+static void lrng_cpu_prefetch_work(struct work_struct *work)
+{
+	struct lrng_cpu_prefetch *pf = container_of(to_delayed_work(work),
+						    struct lrng_cpu_prefetch,
+						    work);
+	u8 buf[LRNG_DRNG_INIT_SEED_SIZE_BYTES] __aligned(LRNG_KCAPI_ALIGN);
+	u32 ent_bits, requested_bits = lrng_get_seed_entropy_osr(true);
+	unsigned long flags;
+
+	/* CPU entropy source is disabled */
+	if (!cpu_entropy)
+		return;
+
+	/* Compress with the hash of the node the buffer is filled for */
+	ent_bits = lrng_get_cpu_data_compress(buf, requested_bits,
+					      lrng_cpu_multiplier(), pf->node);
+	if (!ent_bits) {
+		/* Retry with exponential backoff */
+		pf->backoff = pf->backoff ?
+			min_t(unsigned long, pf->backoff << 1,
+			      LRNG_CPU_PREFETCH_BACKOFF_MAX) :
+			LRNG_CPU_PREFETCH_BACKOFF_MIN;
+		pr_debug("CPU ES prefetch for NUMA node %d failed, retry in %lu jiffies\n",
+			 pf->node, pf->backoff);
+		lrng_cpu_prefetch_schedule(pf, pf->backoff);
+		goto out;
+	}
+	pf->backoff = 0;
+
+	spin_lock_irqsave(&pf->lock, flags);
+	memcpy(pf->data, buf, ent_bits >> 3);
+	pf->requested_bits = requested_bits;
+	pf->ent_bits = ent_bits;
+	spin_unlock_irqrestore(&pf->lock, flags);
+
+	pr_debug("CPU ES prefetch buffer of NUMA node %d filled with %u bits\n",
+		 pf->node, ent_bits);
+
+out:
+	memzero_explicit(buf, sizeof(buf));
+}
+
+/*
+ * Obtain the data from the prefetch buffer of the current NUMA node. Returns
+ * the number of data bits or 0 if the buffer cannot serve the request.
+ */
+static u32 lrng_cpu_prefetch_get(u8 *outbuf, u32 requested_bits)
+{
+	struct lrng_cpu_prefetch **prefetch, *pf;
+	unsigned long flags;
+	u32 ent_bits = 0;
+
+	/* Pairs with the store in lrng_cpu_prefetch_init */
+	prefetch = smp_load_acquire(&lrng_cpu_prefetch);
+	if (!prefetch)
+		return 0;
+
+	pf = prefetch[numa_node_id()];
+
+	spin_lock_irqsave(&pf->lock, flags);
+	if (pf->ent_bits && pf->requested_bits == requested_bits) {
+		ent_bits = pf->ent_bits;
+		memcpy(outbuf, pf->data, ent_bits >> 3);
+		memzero_explicit(pf->data, sizeof(pf->data));
+		pf->ent_bits = 0;
+	}
+	spin_unlock_irqrestore(&pf->lock, flags);
+
+	if (ent_bits)
+		atomic64_inc(&lrng_cpu_prefetch_hits);
+	else
+		atomic64_inc(&lrng_cpu_prefetch_misses);
+
+	/* Refill the buffer unless a retry is already pending */
+	lrng_cpu_prefetch_schedule(pf, 0);
+
+	return ent_bits;
+}
+
+/* Discard the prefetched data of a NUMA node, e.g. after a hash switch */
+static void lrng_cpu_prefetch_invalidate(int node)
+{
+	struct lrng_cpu_prefetch **prefetch, *pf;
+	unsigned long flags;
+
+	prefetch = smp_load_acquire(&lrng_cpu_prefetch);
+	if (!prefetch)
+		return;
+
+	pf = prefetch[node];
+
+	spin_lock_irqsave(&pf->lock, flags);
+	memzero_explicit(pf->data, sizeof(pf->data));
+	pf->ent_bits = 0;
+	spin_unlock_irqrestore(&pf->lock, flags);
+
+	lrng_cpu_prefetch_schedule(pf, 0);
+}
+
+static void lrng_cpu_prefetch_state(unsigned char *buf, size_t buflen)
+{
+	snprintf(buf, buflen,
+		 " Prefetch hits: %llu\n"
+		 " Prefetch misses: %llu\n",
+		 atomic64_read(&lrng_cpu_prefetch_hits),
+		 atomic64_read(&lrng_cpu_prefetch_misses));
+}
+
+static struct lrng_cpu_prefetch *lrng_cpu_prefetch_alloc(int node)
+{
+	struct lrng_cpu_prefetch *pf = kzalloc_node(sizeof(*pf), GFP_KERNEL,
+						    node);
+
+	if (!pf)
+		return NULL;
+
+	spin_lock_init(&pf->lock);
+	INIT_DELAYED_WORK(&pf->work, lrng_cpu_prefetch_work);
+	pf->node = node;
+
+	return pf;
+}
+
+static int __init lrng_cpu_prefetch_init(void)
+{
+	struct lrng_cpu_prefetch **prefetch, *first;
+	int node;
+
+	/* Data not requiring compression is obtained directly */
+	if (!cpu_entropy || lrng_cpu_multiplier() <= 1)
+		return 0;
+
+	prefetch = kcalloc(nr_node_ids, sizeof(*prefetch), GFP_KERNEL);
+	if (!prefetch)
+		return -ENOMEM;
+
+	first = lrng_cpu_prefetch_alloc(first_online_node);
+	if (!first) {
+		kfree(prefetch);
+		return -ENOMEM;
+	}
+
+	for_each_node(node) {
+		struct lrng_cpu_prefetch *pf = first;
+
+		if (node != first_online_node && node_online(node))
+			pf = lrng_cpu_prefetch_alloc(node) ? : first;
+
+		prefetch[node] = pf;
+	}
+
+	/* Pairs with the reads in lrng_cpu_prefetch_get and _invalidate */
+	smp_store_release(&lrng_cpu_prefetch, prefetch);
+
+	for_each_node(node) {
+		if (prefetch[node]->node == node)
+			lrng_cpu_prefetch_schedule(prefetch[node], 0);
+	}
+
+	pr_info("CPU entropy source prefetching enabled\n");
+
+	return 0;
+}
+device_initcall(lrng_cpu_prefetch_init);
+
+#else /* CONFIG_LRNG_CPU_PREFETCH */
+
+static inline u32 lrng_cpu_prefetch_get(u8 *outbuf, u32 requested_bits)
+{
+	return 0;
+}
+
+static inline void lrng_cpu_prefetch_invalidate(int node) { }
+static inline void
+lrng_cpu_prefetch_state(unsigned char *buf, size_t buflen) { }
+
+#endif /* CONFIG_LRNG_CPU_PREFETCH */
+
 static int
 lrng_cpu_switch_hash(struct lrng_drng *drng, int node,
 		     const struct lrng_hash_cb *new_cb, void *new_hash,
@@ -225,6 +509,10 @@ lrng_cpu_switch_hash(struct lrng_drng *drng, int node,
 	 */
 	WARN_ON(multiplier > 1 && digestsize < cpu_entropy);
 	cpu_entropy = min_t(u32, digestsize, cpu_entropy);
+
+	/* Prefetched data was compressed with the old hash */
+	lrng_cpu_prefetch_invalidate(node);
+
 	return 0;
 }
 
@@ -235,7 +523,7 @@ lrng_cpu_switch_hash(struct lrng_drng *drng, int node,
  * @requested_bits: requested entropy in bits
  */
 static void lrng_cpu_get(struct entropy_buf *eb, u32 requested_bits,
-			 bool __unused)
+			 bool __unused, int node)
 {
 	u32 ent_bits, data_multiplier = lrng_cpu_multiplier();
 
@@ -243,11 +531,16 @@ static void lrng_cpu_get(struct entropy_buf *eb, u32 requested_bits,
 		ent_bits = lrng_get_cpu_data(eb->e[lrng_ext_es_cpu],
 					     requested_bits);
 	} else {
-		ent_bits = lrng_get_cpu_data_compress(eb->e[lrng_ext_es_cpu],
-						      requested_bits,
-						      data_multiplier);
+		ent_bits = lrng_cpu_prefetch_get(eb->e[lrng_ext_es_cpu],
+						 requested_bits);
+		if (!ent_bits)
+			ent_bits = lrng_get_cpu_data_compress(
+				eb->e[lrng_ext_es_cpu], requested_bits,
+				data_multiplier, NUMA_NO_NODE);
 	}
 
+	/* The CPU ES delivers one data bit per bit before the entropy rate */
+	eb->e_len[lrng_ext_es_cpu] = ent_bits >> 3;
 	ent_bits = lrng_cpu_entropylevel(ent_bits);
 	pr_debug("obtained %u bits of entropy from CPU RNG entropy source\n",
 		 ent_bits);
@@ -258,16 +551,22 @@ static void lrng_cpu_es_state(unsigned char *buf, size_t buflen)
 {
 	const struct lrng_drng *lrng_drng_init = lrng_drng_init_instance();
 	u32 data_multiplier = lrng_cpu_multiplier();
+	size_t len;
 
 	/* Assume the lrng_drng_init lock is taken by caller */
 	snprintf(buf, buflen,
 		 " Hash for compressing data: %s\n"
 		 " Available entropy: %u\n"
-		 " Data multiplier: %u\n",
+		 " Data multiplier: %u\n"
+		 " Failed requests: %llu\n",
 		 (data_multiplier <= 1) ?
 			"N/A" : lrng_drng_init->hash_cb->hash_name(),
 		 lrng_cpu_poolsize(),
-		 data_multiplier);
+		 data_multiplier,
+		 atomic64_read(&lrng_cpu_failures));
+
+	len = strlen(buf);
+	lrng_cpu_prefetch_state(buf + len, buflen - len);
 }
 
 struct lrng_es_cb lrng_es_cpu = {
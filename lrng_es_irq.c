@@ -337,9 +337,11 @@ lrng_irq_pool_hash_one(const struct lrng_hash_cb *pcpu_hash_cb,
  * @eb: entropy buffer to store entropy
  * @requested_bits: Requested amount of entropy
  * @fully_seeded: indicator whether LRNG is fully seeded
+ * @node: NUMA node whose per-CPU pools are harvested first, the remote pools
+ *	  are only harvested if the local pools do not suffice
  */
 static void lrng_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits,
-			       bool fully_seeded)
+			       bool fully_seeded, int node)
 {
 	SHASH_DESC_ON_STACK(shash, NULL);
 	const struct lrng_hash_cb *hash_cb;
@@ -351,10 +353,12 @@ static void lrng_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 	    returned_ent_bits;
 	int ret, cpu;
 	void *hash;
+	bool remote = (node == NUMA_NO_NODE);
 
 	/* Only deliver entropy when SP800-90B self test is completed */
 	if (!lrng_sp80090b_startup_complete_es(lrng_int_es_irq)) {
 		eb->e_bits[lrng_int_es_irq] = 0;
+		eb->e_len[lrng_int_es_irq] = 0;
 		return;
 	}
 
@@ -377,19 +381,26 @@ static void lrng_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 
 	/*
 	 * Harvest entropy from each per-CPU hash state - even though we may
-	 * have collected sufficient entropy, we will hash all per-CPU pools.
+	 * have collected sufficient entropy, we will hash all per-CPU pools of
+	 * the pass. The pools of the remote CPUs are only harvested if the
+	 * pools of the CPUs on the preferred NUMA node do not suffice.
 	 */
+again:
 	for_each_online_cpu(cpu) {
 		struct lrng_drng *pcpu_drng = drng;
 		u32 digestsize, pcpu_unused_irqs = 0;
-		int node = cpu_to_node(cpu);
+		int cpu_node = cpu_to_node(cpu);
+
+		if (!lrng_pcpu_pool_in_pass(cpu, node, remote))
+			continue;
 
 		/* If pool is not online, then no entropy is present. */
 		if (!lrng_irq_pool_online(cpu))
 			continue;
 
-		if (lrng_drng && lrng_drng[node])
-			pcpu_drng = lrng_drng[node];
+		/* The DRNG of the node may go online or offline concurrently */
+		if (lrng_drng)
+			pcpu_drng = READ_ONCE(lrng_drng[cpu_node]) ?: drng;
 
 		if (pcpu_drng == drng) {
 			found_irqs = lrng_irq_pool_hash_one(hash_cb, hash,
@@ -420,6 +431,12 @@ static void lrng_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 			 found_irqs - pcpu_unused_irqs, cpu, pcpu_unused_irqs);
 	}
 
+	/* Fall back to the remote pools if the local entropy is short */
+	if (!remote && collected_irqs < requested_irqs) {
+		remote = true;
+		goto again;
+	}
+
 	ret = hash_cb->hash_final(shash, digest);
 	if (ret)
 		goto err;
@@ -442,8 +459,9 @@ static void lrng_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 	 * estimate underestimates the available entropy we can transport as
 	 * much available entropy as possible.
 	 */
-	memcpy(eb->e[lrng_int_es_irq], digest,
-	       fully_seeded ? returned_ent_bits >> 3 : requested_bits >> 3);
+	eb->e_len[lrng_int_es_irq] = fully_seeded ? returned_ent_bits >> 3 :
+				     requested_bits >> 3;
+	memcpy(eb->e[lrng_int_es_irq], digest, eb->e_len[lrng_int_es_irq]);
 	eb->e_bits[lrng_int_es_irq] = returned_ent_bits;
 
 out:
@@ -454,6 +472,7 @@ out:
 
 err:
 	eb->e_bits[lrng_int_es_irq] = 0;
+	eb->e_len[lrng_int_es_irq] = 0;
 	goto out;
 }
 
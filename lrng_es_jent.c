@@ -8,10 +8,17 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <crypto/rng.h>
+#include <linux/cpumask.h>
 #include <linux/fips.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/sched/isolation.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
 #include <linux/types.h>
+#include <linux/wait.h>
 
 #include "lrng_definitions.h"
 #include "lrng_es_aux.h"
@@ -33,7 +40,6 @@ MODULE_PARM_DESC(jent_entropy,
 #endif
 
 static bool lrng_jent_initialized = false;
-static struct crypto_rng *jent;
 
 #if (CONFIG_LRNG_JENT_ENTROPY_BLOCKS != 0)
 
@@ -42,13 +48,9 @@ static struct crypto_rng *jent;
 
 struct jent_entropy_es {
 	uint8_t e[LRNG_DRNG_INIT_SEED_SIZE_BYTES];
-	uint32_t e_bits;
+	uint32_t e_bits, e_len;
 };
 
-/* Buffer that is filled with Jitter RNG data by a thread. */
-static struct jent_entropy_es
-	lrng_jent_async[CONFIG_LRNG_JENT_ENTROPY_BLOCKS] __aligned(sizeof(u64));
-
 /* State of each Jitter RNG buffer entry to ensure atomic access. */
 enum lrng_jent_async_state {
 	buffer_empty,
@@ -56,10 +58,22 @@ enum lrng_jent_async_state {
 	buffer_filled,
 	buffer_reading,
 };
-static atomic_t lrng_jent_async_set[CONFIG_LRNG_JENT_ENTROPY_BLOCKS];
 
-/* Jitter RNG buffer work handler. */
-static struct work_struct lrng_jent_async_work;
+/*
+ * Refill watermarks of the Jitter RNG buffer in number of filled slots: the
+ * refill thread is woken up when the number of filled slots drops below the
+ * low watermark and fills slots until the high watermark is reached. The
+ * low watermark is raised above its minimum when the observed consumption
+ * rate would drain the buffer before the refill thread catches up (see
+ * lrng_jent_async_low_wm()).
+ */
+#define LRNG_JENT_ASYNC_LOW_WM_MIN	(CONFIG_LRNG_JENT_ENTROPY_BLOCKS >> 2)
+#define LRNG_JENT_ASYNC_LOW_WM_MAX	(CONFIG_LRNG_JENT_ENTROPY_BLOCKS -      \
+					 LRNG_JENT_ASYNC_LOW_WM_MIN)
+#define LRNG_JENT_ASYNC_HIGH_WM		CONFIG_LRNG_JENT_ENTROPY_BLOCKS
+
+/* Weight of a new sample in the rate estimates: 1 / (1 << shift) */
+#define LRNG_JENT_ASYNC_EWMA_SHIFT	3
 
 /* Is the asynchronous operation enabled? */
 static bool lrng_es_jent_async_enabled = true;
@@ -71,6 +85,51 @@ static bool lrng_es_jent_async_enabled = false;
 
 #endif /* CONFIG_LRNG_JENT_ENTROPY_BLOCKS */
 
+/*
+ * Per-NUMA node Jitter RNG state
+ *
+ * Each online NUMA node has its own Jitter RNG instance. When the asynchronous
+ * collection is enabled, each node also has its own buffer that is filled by
+ * a kernel thread bound to the housekeeping CPUs of that node. This allows
+ * the reseed of the per-NUMA node DRNGs to obtain Jitter RNG data in parallel
+ * without serializing on one Jitter RNG instance.
+ */
+struct lrng_jent_node {
+	struct crypto_rng *jent;	/* Jitter RNG instance */
+	spinlock_t lock;		/* Serialize access to jent */
+	int node;			/* NUMA node owning the instance */
+	atomic64_t sync;		/* Synchronous collections for callers */
+#if (CONFIG_LRNG_JENT_ENTROPY_BLOCKS != 0)
+	/* Buffer that is filled with Jitter RNG data by a thread. */
+	struct jent_entropy_es async[CONFIG_LRNG_JENT_ENTROPY_BLOCKS]
+							__aligned(sizeof(u64));
+	/* State of each Jitter RNG buffer entry to ensure atomic access. */
+	atomic_t async_set[CONFIG_LRNG_JENT_ENTROPY_BLOCKS];
+	atomic_t idx;			/* Next buffer slot to read */
+	atomic_t filled;		/* Number of filled buffer slots */
+	atomic_t refill;		/* Buffer refill requested */
+	u64 last_get_ns;		/* Time of last buffer consumption */
+	u64 consume_ns;			/* Average time between consumptions */
+	u64 fill_ns;			/* Average time to fill one slot */
+	atomic64_t hits;		/* Requests served from the buffer */
+	atomic64_t misses;		/* Requests finding the buffer empty */
+	wait_queue_head_t refill_wait;	/* Refill thread wait queue */
+	struct task_struct *thread;	/* Refill thread */
+#endif /* CONFIG_LRNG_JENT_ENTROPY_BLOCKS */
+};
+
+/*
+ * Jitter RNG state for all possible NUMA nodes. Nodes without their own
+ * instance refer to the instance of the first online node.
+ */
+static struct lrng_jent_node **lrng_jent_nodes __read_mostly;
+static u32 lrng_jent_instances = 0;
+
+/* Iterate over all NUMA nodes owning a Jitter RNG instance */
+#define for_each_lrng_jent_node(node, jn)				\
+	for_each_node(node)						\
+		if (((jn) = lrng_jent_nodes[node]) && (jn)->node == (node))
+
 static u32 lrng_jent_entropylevel(u32 requested_bits)
 {
 	return lrng_fast_noise_entropylevel(lrng_jent_initialized ?
@@ -82,19 +141,25 @@ static u32 lrng_jent_poolsize(void)
 	return lrng_jent_entropylevel(lrng_security_strength());
 }
 
-static void __lrng_jent_get(u8 *e, u32 *e_bits, u32 requested_bits)
+/* Jitter RNG state of the NUMA node the caller executes on */
+static struct lrng_jent_node *lrng_jent_node_instance(void)
+{
+	return lrng_jent_nodes[numa_node_id()];
+}
+
+static void __lrng_jent_get(struct lrng_jent_node *jn, u8 *e, u32 *e_bits,
+			    u32 *e_len, u32 requested_bits)
 {
 	int ret;
 	u32 ent_bits = lrng_jent_entropylevel(requested_bits);
 	unsigned long flags;
-	static DEFINE_SPINLOCK(lrng_jent_lock);
 
 	if (!lrng_jent_initialized)
 		goto err;
 
-	spin_lock_irqsave(&lrng_jent_lock, flags);
-	ret = crypto_rng_get_bytes(jent, e, requested_bits >> 3);
-	spin_unlock_irqrestore(&lrng_jent_lock, flags);
+	spin_lock_irqsave(&jn->lock, flags);
+	ret = crypto_rng_get_bytes(jn->jent, e, requested_bits >> 3);
+	spin_unlock_irqrestore(&jn->lock, flags);
 
 	if (ret) {
 		pr_debug("Jitter RNG failed with %d\n", ret);
@@ -105,10 +170,12 @@ static void __lrng_jent_get(u8 *e, u32 *e_bits, u32 requested_bits)
 		 ent_bits);
 
 	*e_bits = ent_bits;
+	*e_len = requested_bits >> 3;
 	return;
 
 err:
 	*e_bits = 0;
+	*e_len = 0;
 }
 
 /*
@@ -120,22 +187,78 @@ err:
 static void lrng_jent_get(struct entropy_buf *eb, u32 requested_bits,
 			  bool __unused)
 {
-	__lrng_jent_get(eb->e[lrng_ext_es_jitter],
-			&eb->e_bits[lrng_ext_es_jitter], requested_bits);
+	struct lrng_jent_node *jn;
+
+	if (!lrng_jent_initialized) {
+		eb->e_bits[lrng_ext_es_jitter] = 0;
+		eb->e_len[lrng_ext_es_jitter] = 0;
+		return;
+	}
+
+	jn = lrng_jent_node_instance();
+	atomic64_inc(&jn->sync);
+	__lrng_jent_get(jn, eb->e[lrng_ext_es_jitter],
+			&eb->e_bits[lrng_ext_es_jitter],
+			&eb->e_len[lrng_ext_es_jitter], requested_bits);
 }
 
 #if (CONFIG_LRNG_JENT_ENTROPY_BLOCKS != 0)
 
-/* Fill the Jitter RNG buffer with random data. */
-static void lrng_jent_async_monitor(struct work_struct *__unused)
+/* Update an exponentially weighted moving average with a new sample */
+static void lrng_jent_async_ewma(u64 *avg, u64 sample)
+{
+	u64 old = READ_ONCE(*avg);
+
+	/* The first sample initializes the average */
+	if (!old) {
+		WRITE_ONCE(*avg, sample);
+		return;
+	}
+
+	WRITE_ONCE(*avg, old - (old >> LRNG_JENT_ASYNC_EWMA_SHIFT) +
+			 (sample >> LRNG_JENT_ASYNC_EWMA_SHIFT));
+}
+
+/*
+ * Low watermark of the buffer of one NUMA node: keep enough filled slots to
+ * serve the consumers while the refill thread produces the minimum low
+ * watermark number of slots at the observed fill and consumption rates.
+ */
+static int lrng_jent_async_low_wm(struct lrng_jent_node *jn)
+{
+	u64 consume_ns = READ_ONCE(jn->consume_ns);
+	u64 lead;
+
+	if (!consume_ns)
+		return LRNG_JENT_ASYNC_LOW_WM_MIN;
+
+	lead = div64_u64(READ_ONCE(jn->fill_ns) * LRNG_JENT_ASYNC_LOW_WM_MIN,
+			 consume_ns);
+
+	return (int)clamp_t(u64, lead, LRNG_JENT_ASYNC_LOW_WM_MIN,
+			    LRNG_JENT_ASYNC_LOW_WM_MAX);
+}
+
+/* Fill the Jitter RNG buffer of one NUMA node with random data. */
+static void lrng_jent_async_monitor(struct lrng_jent_node *jn)
 {
 	unsigned int i, requested_bits = lrng_get_seed_entropy_osr(true);
 
-	pr_debug("Jitter RNG block filling started\n");
+	pr_debug("Jitter RNG block filling for NUMA node %d started\n",
+		 jn->node);
 
 	for (i = 0; i < CONFIG_LRNG_JENT_ENTROPY_BLOCKS; i++) {
+		u64 start;
+
+		if (!lrng_es_jent_async_enabled || kthread_should_stop())
+			break;
+
+		/* Stop at the high watermark */
+		if (atomic_read(&jn->filled) >= LRNG_JENT_ASYNC_HIGH_WM)
+			break;
+
 		/* Ensure atomic access to the Jitter RNG buffer slot. */
-		if (atomic_cmpxchg(&lrng_jent_async_set[i],
+		if (atomic_cmpxchg(&jn->async_set[i],
 				   buffer_empty, buffer_filling) !=
 		    buffer_empty)
 			continue;
@@ -144,43 +267,83 @@ static void lrng_jent_async_monitor(struct work_struct *__unused)
 		 * Always gather entropy data including
 		 * potential oversampling factor.
 		 */
-		__lrng_jent_get(lrng_jent_async[i].e,
-				&lrng_jent_async[i].e_bits, requested_bits);
+		start = ktime_get_ns();
+		__lrng_jent_get(jn, jn->async[i].e, &jn->async[i].e_bits,
+				&jn->async[i].e_len, requested_bits);
+		lrng_jent_async_ewma(&jn->fill_ns, ktime_get_ns() - start);
 
-		atomic_set(&lrng_jent_async_set[i], buffer_filled);
+		atomic_set(&jn->async_set[i], buffer_filled);
+		atomic_inc(&jn->filled);
 
-		pr_debug("Jitter RNG ES monitor: filled slot %u with %u bits of entropy\n",
-			 i, requested_bits);
+		pr_debug("Jitter RNG ES monitor: filled slot %u of NUMA node %d with %u bits of entropy\n",
+			 i, jn->node, requested_bits);
 
-		schedule();
+		cond_resched();
 	}
 
-	pr_debug("Jitter RNG block filling completed\n");
+	pr_debug("Jitter RNG block filling for NUMA node %d completed\n",
+		 jn->node);
 }
 
-static void lrng_jent_async_monitor_schedule(void)
+/* Jitter RNG buffer refill thread of one NUMA node */
+static int lrng_jent_async_thread(void *data)
 {
-	if (lrng_es_jent_async_enabled)
-		schedule_work(&lrng_jent_async_work);
+	struct lrng_jent_node *jn = data;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(jn->refill_wait,
+					 atomic_read(&jn->refill) ||
+					 kthread_should_stop());
+		atomic_set(&jn->refill, 0);
+		lrng_jent_async_monitor(jn);
+	}
+
+	return 0;
+}
+
+static void lrng_jent_async_monitor_schedule(struct lrng_jent_node *jn)
+{
+	if (!lrng_es_jent_async_enabled)
+		return;
+
+	atomic_set(&jn->refill, 1);
+	wake_up_interruptible(&jn->refill_wait);
 }
 
 static void lrng_jent_async_fini(void)
 {
+	struct lrng_jent_node *jn;
+	int node;
+
 	/* Reset state */
-	memzero_explicit(lrng_jent_async, sizeof(lrng_jent_async));
+	for_each_lrng_jent_node(node, jn) {
+		memzero_explicit(jn->async, sizeof(jn->async));
+		atomic_set(&jn->filled, 0);
+	}
+}
+
+/* Record the consumption of a buffer slot for the rate estimate */
+static void lrng_jent_async_consumed(struct lrng_jent_node *jn)
+{
+	u64 now = ktime_get_ns(), last = READ_ONCE(jn->last_get_ns);
+
+	WRITE_ONCE(jn->last_get_ns, now);
+	if (last && now > last)
+		lrng_jent_async_ewma(&jn->consume_ns, now - last);
 }
 
 /* Get Jitter RNG data from the buffer */
 static void lrng_jent_async_get(struct entropy_buf *eb, uint32_t requested_bits,
 				bool __unused)
 {
-	static atomic_t idx = ATOMIC_INIT(-1);
-	unsigned int slot;
+	struct lrng_jent_node *jn;
+	unsigned int i, slot = 0;
 
 	(void)requested_bits;
 
 	if (!lrng_jent_initialized) {
 		eb->e_bits[lrng_ext_es_jitter] = 0;
+		eb->e_len[lrng_ext_es_jitter] = 0;
 		return;
 	}
 
@@ -188,40 +351,72 @@ static void lrng_jent_async_get(struct entropy_buf *eb, uint32_t requested_bits,
 	BUILD_BUG_ON((CONFIG_LRNG_JENT_ENTROPY_BLOCKS &
 		      LRNG_JENT_ENTROPY_BLOCKS_MASK) != 0);
 
-	slot = ((unsigned int)atomic_inc_return(&idx)) &
-		LRNG_JENT_ENTROPY_BLOCKS_MASK;
+	jn = lrng_jent_node_instance();
+	lrng_jent_async_consumed(jn);
 
-	/* Ensure atomic access to the Jitter RNG buffer slot. */
-	if (atomic_cmpxchg(&lrng_jent_async_set[slot],
-			   buffer_filled, buffer_reading) != buffer_filled) {
-		pr_debug("Jitter RNG ES monitor: buffer slot %u exhausted\n",
-			 slot);
-		lrng_jent_get(eb, requested_bits, __unused);
-		lrng_jent_async_monitor_schedule();
+	/*
+	 * Search for a filled slot starting at the next slot in line as the
+	 * refill thread does not necessarily fill the slots in the order
+	 * they are consumed.
+	 */
+	if (atomic_read(&jn->filled) > 0) {
+		unsigned int start = (unsigned int)atomic_inc_return(&jn->idx);
+
+		for (i = 0; i < CONFIG_LRNG_JENT_ENTROPY_BLOCKS; i++) {
+			slot = (start + i) & LRNG_JENT_ENTROPY_BLOCKS_MASK;
+
+			/* Ensure atomic access to the Jitter RNG buffer slot. */
+			if (atomic_cmpxchg(&jn->async_set[slot],
+					   buffer_filled, buffer_reading) ==
+			    buffer_filled)
+				break;
+		}
+	} else {
+		i = CONFIG_LRNG_JENT_ENTROPY_BLOCKS;
+	}
+
+	if (i >= CONFIG_LRNG_JENT_ENTROPY_BLOCKS) {
+		pr_debug("Jitter RNG ES monitor: buffer of NUMA node %d exhausted\n",
+			 jn->node);
+		atomic64_inc(&jn->misses);
+		atomic64_inc(&jn->sync);
+		lrng_jent_async_monitor_schedule(jn);
+		__lrng_jent_get(jn, eb->e[lrng_ext_es_jitter],
+				&eb->e_bits[lrng_ext_es_jitter],
+				&eb->e_len[lrng_ext_es_jitter],
+				requested_bits);
 		return;
 	}
 
-	pr_debug("Jitter RNG ES monitor: used slot %u\n", slot);
-	memcpy(eb->e[lrng_ext_es_jitter], lrng_jent_async[slot].e,
+	atomic64_inc(&jn->hits);
+
+	pr_debug("Jitter RNG ES monitor: used slot %u of NUMA node %d\n",
+		 slot, jn->node);
+	memcpy(eb->e[lrng_ext_es_jitter], jn->async[slot].e,
 	       LRNG_DRNG_INIT_SEED_SIZE_BYTES);
-	eb->e_bits[lrng_ext_es_jitter] = lrng_jent_async[slot].e_bits;
+	eb->e_bits[lrng_ext_es_jitter] = jn->async[slot].e_bits;
+	eb->e_len[lrng_ext_es_jitter] = jn->async[slot].e_len;
 
 	pr_debug("obtained %u bits of entropy from Jitter RNG noise source\n",
 		 eb->e_bits[lrng_ext_es_jitter]);
 
-	memzero_explicit(&lrng_jent_async[slot],
-			 sizeof(struct jent_entropy_es));
+	memzero_explicit(&jn->async[slot], sizeof(struct jent_entropy_es));
 
-	atomic_set(&lrng_jent_async_set[slot], buffer_empty);
+	atomic_set(&jn->async_set[slot], buffer_empty);
 
-	/* Ensure division in the following check works */
-	BUILD_BUG_ON(CONFIG_LRNG_JENT_ENTROPY_BLOCKS < 4);
-	if (!(slot % (CONFIG_LRNG_JENT_ENTROPY_BLOCKS / 4)) && slot)
-		lrng_jent_async_monitor_schedule();
+	/*
+	 * Ensure the low watermark is not zero. The watermark is compared as
+	 * signed value as the fill counter drops below zero when it is reset
+	 * concurrently with the consumption of a slot.
+	 */
+	BUILD_BUG_ON(LRNG_JENT_ASYNC_LOW_WM_MIN < 1);
+	if (atomic_dec_return(&jn->filled) < lrng_jent_async_low_wm(jn))
+		lrng_jent_async_monitor_schedule(jn);
 }
 
 static void lrng_jent_get_check(struct entropy_buf *eb,
-				uint32_t requested_bits, bool __unused)
+				uint32_t requested_bits, bool __unused,
+				int node)
 {
 	if (lrng_es_jent_async_enabled &&
 	    (requested_bits == lrng_get_seed_entropy_osr(true))) {
@@ -233,19 +428,101 @@ static void lrng_jent_get_check(struct entropy_buf *eb,
 
 static void lrng_jent_async_init(void)
 {
+	struct lrng_jent_node *jn;
 	unsigned int i;
+	int node;
 
 	if (!lrng_es_jent_async_enabled)
 		return;
 
-	for (i = 0; i < CONFIG_LRNG_JENT_ENTROPY_BLOCKS; i++)
-		atomic_set(&lrng_jent_async_set[i], buffer_empty);
+	for_each_lrng_jent_node(node, jn) {
+		for (i = 0; i < CONFIG_LRNG_JENT_ENTROPY_BLOCKS; i++)
+			atomic_set(&jn->async_set[i], buffer_empty);
+		atomic_set(&jn->filled, 0);
+	}
+}
+
+static void lrng_jent_async_schedule_all(void)
+{
+	struct lrng_jent_node *jn;
+	int node;
+
+	for_each_lrng_jent_node(node, jn)
+		lrng_jent_async_monitor_schedule(jn);
+}
+
+/*
+ * Bind the refill thread to the housekeeping CPUs of its NUMA node. If the
+ * node has no housekeeping CPU, use any housekeeping CPU.
+ */
+static void lrng_jent_async_thread_affine(struct lrng_jent_node *jn)
+{
+	const struct cpumask *hk = housekeeping_cpumask(HK_TYPE_KTHREAD);
+	cpumask_var_t mask;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+	cpumask_and(mask, cpumask_of_node(jn->node), hk);
+	if (cpumask_empty(mask))
+		cpumask_copy(mask, hk);
+	set_cpus_allowed_ptr(jn->thread, mask);
+
+	free_cpumask_var(mask);
+}
+
+static void lrng_jent_async_node_init(struct lrng_jent_node *jn)
+{
+	atomic_set(&jn->idx, -1);
+	atomic_set(&jn->refill, 0);
+	init_waitqueue_head(&jn->refill_wait);
+}
+
+static void lrng_jent_async_stats(unsigned char *buf, size_t buflen)
+{
+	struct lrng_jent_node *jn;
+	u64 hits = 0, misses = 0;
+	unsigned int filled = 0;
+	int node;
+
+	for_each_lrng_jent_node(node, jn) {
+		hits += atomic64_read(&jn->hits);
+		misses += atomic64_read(&jn->misses);
+		filled += atomic_read(&jn->filled);
+	}
+
+	snprintf(buf, buflen,
+		 " Jitter RNG async filled slots: %u\n"
+		 " Jitter RNG async hits: %llu\n"
+		 " Jitter RNG async misses: %llu\n",
+		 filled, hits, misses);
 }
 
 static void lrng_jent_async_init_complete(void)
 {
+	struct lrng_jent_node *jn;
+	int node;
+
 	lrng_jent_async_init();
-	INIT_WORK(&lrng_jent_async_work, lrng_jent_async_monitor);
+
+	for_each_lrng_jent_node(node, jn) {
+		struct task_struct *thread;
+
+		thread = kthread_create_on_node(lrng_jent_async_thread, jn,
+						node, "lrng_jent/%d", node);
+		if (IS_ERR(thread)) {
+			pr_warn("Cannot start Jitter RNG thread for NUMA node %d\n",
+				node);
+			continue;
+		}
+
+		jn->thread = thread;
+		lrng_jent_async_thread_affine(jn);
+		wake_up_process(thread);
+	}
+
+	/* Pre-fill the buffers */
+	lrng_jent_async_schedule_all();
 }
 
 #if (defined(CONFIG_SYSFS) && defined(CONFIG_LRNG_RUNTIME_ES_CONFIG))
@@ -269,7 +546,7 @@ static int lrng_jent_async_sysfs_set(const char *val,
 			lrng_es_jent_async_enabled = 1;
 			lrng_jent_async_init();
 			pr_devel("Jitter RNG async data collection enabled\n");
-			lrng_jent_async_monitor_schedule();
+			lrng_jent_async_schedule_all();
 		}
 	} else {
 		if (lrng_es_jent_async_enabled) {
@@ -295,39 +572,114 @@ MODULE_PARM_DESC(lrng_es_jent_async_enabled,
 #else /* CONFIG_LRNG_JENT_ENTROPY_BLOCKS */
 
 static void lrng_jent_get_check(struct entropy_buf *eb,
-				uint32_t requested_bits, bool __unused)
+				uint32_t requested_bits, bool __unused,
+				int node)
 {
 	lrng_jent_get(eb, requested_bits, __unused);
 }
 
+static inline void lrng_jent_async_node_init(struct lrng_jent_node *jn) { }
+static inline void
+lrng_jent_async_stats(unsigned char *buf, size_t buflen) { }
 static inline void __init lrng_jent_async_init_complete(void) { }
 
 #endif /* CONFIG_LRNG_JENT_ENTROPY_BLOCKS */
 
 static void lrng_jent_es_state(unsigned char *buf, size_t buflen)
 {
+	struct lrng_jent_node *jn;
+	u64 sync = 0;
+	size_t len;
+	int node;
+
+	if (lrng_jent_initialized) {
+		for_each_lrng_jent_node(node, jn)
+			sync += atomic64_read(&jn->sync);
+	}
+
 	snprintf(buf, buflen,
 		 " Available entropy: %u\n"
 		 " Enabled: %s\n"
-		 " Jitter RNG async collection %s\n",
+		 " Jitter RNG instances: %u\n"
+		 " Jitter RNG async collection %s\n"
+		 " Jitter RNG sync collections: %llu\n",
 		 lrng_jent_poolsize(),
 		 lrng_jent_initialized ? "true" : "false",
-		 lrng_es_jent_async_enabled ? "true" : "false");
+		 lrng_jent_instances,
+		 lrng_es_jent_async_enabled ? "true" : "false",
+		 sync);
+
+	if (!lrng_jent_initialized)
+		return;
+
+	len = strlen(buf);
+	lrng_jent_async_stats(buf + len, buflen - len);
+}
+
+/* Allocate the Jitter RNG state for one NUMA node */
+static struct lrng_jent_node *lrng_jent_node_alloc(int node)
+{
+	struct lrng_jent_node *jn;
+
+	jn = kzalloc_node(sizeof(*jn), GFP_KERNEL, node);
+	if (!jn)
+		return ERR_PTR(-ENOMEM);
+
+	jn->jent = crypto_alloc_rng("jitterentropy_rng", 0, 0);
+	if (IS_ERR(jn->jent)) {
+		int ret = PTR_ERR(jn->jent);
+
+		kfree(jn);
+		return ERR_PTR(ret);
+	}
+
+	spin_lock_init(&jn->lock);
+	jn->node = node;
+	lrng_jent_async_node_init(jn);
+	lrng_jent_instances++;
+
+	return jn;
 }
 
 static int __init lrng_jent_initialize(void)
 {
-	jent = crypto_alloc_rng("jitterentropy_rng", 0, 0);
-	if (IS_ERR(jent)) {
+	struct lrng_jent_node *first;
+	int node;
+
+	lrng_jent_nodes = kcalloc(nr_node_ids, sizeof(*lrng_jent_nodes),
+				  GFP_KERNEL);
+	if (!lrng_jent_nodes)
+		return -ENOMEM;
+
+	first = lrng_jent_node_alloc(first_online_node);
+	if (IS_ERR(first)) {
 		pr_err("Cannot allocate Jitter RNG\n");
-		return PTR_ERR(jent);
+		kfree(lrng_jent_nodes);
+		lrng_jent_nodes = NULL;
+		return PTR_ERR(first);
 	}
 
-	lrng_jent_async_init_complete();
+	for_each_node(node) {
+		struct lrng_jent_node *jn = first;
+
+		if (node != first_online_node && node_online(node)) {
+			jn = lrng_jent_node_alloc(node);
+			if (IS_ERR(jn)) {
+				pr_warn("Cannot allocate Jitter RNG for NUMA node %d, using instance of node %d\n",
+					node, first_online_node);
+				jn = first;
+			}
+		}
+
+		lrng_jent_nodes[node] = jn;
+	}
 
 	lrng_jent_initialized = true;
 	pr_debug("Jitter RNG working on current system\n");
 
+	/* Start the buffer refill threads once the instances are usable */
+	lrng_jent_async_init_complete();
+
 	/*
 	 * In FIPS mode, the Jitter RNG is defined to have full of entropy
 	 * unless a different value has been specified at the command line
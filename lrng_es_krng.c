@@ -68,7 +68,7 @@ static u32 lrng_krng_poolsize(void)
  * @requested_bits: requested entropy in bits
  */
 static void lrng_krng_get(struct entropy_buf *eb, u32 requested_bits,
-			  bool __unused)
+			  bool __unused, int node)
 {
 	u32 ent_bits = lrng_krng_entropylevel(requested_bits);
 
@@ -78,6 +78,7 @@ static void lrng_krng_get(struct entropy_buf *eb, u32 requested_bits,
 		 ent_bits);
 
 	eb->e_bits[lrng_ext_es_krng] = ent_bits;
+	eb->e_len[lrng_ext_es_krng] = requested_bits >> 3;
 }
 
 static void lrng_krng_es_state(unsigned char *buf, size_t buflen)
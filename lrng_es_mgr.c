@@ -7,8 +7,10 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/jump_label.h>
 #include <linux/module.h>
 #include <linux/random.h>
+#include <linux/rwsem.h>
 #include <linux/utsname.h>
 #include <linux/workqueue.h>
 #include <asm/archrandom.h>
@@ -30,6 +32,7 @@
 #include "lrng_es_sched.h"
 #include "lrng_interface_dev_common.h"
 #include "lrng_interface_random_kernel.h"
+#include "lrng_trace.h"
 
 struct lrng_state {
 	bool can_invalidate;		/* Can invalidate batched entropy? */
@@ -49,7 +52,7 @@ struct lrng_state {
 	 */
 
 	atomic_t boot_entropy_thresh;	/* Reseed threshold */
-	struct mutex reseed_in_progress;	/* Flag for on executing reseed */
+	struct rw_semaphore reseed_in_progress;	/* Flag for executing reseed */
 	struct work_struct lrng_seed_work;	/* (re)seed work queue */
 };
 
@@ -57,7 +60,7 @@ static struct lrng_state lrng_state = {
 	false, false, false, false, false, false,
 	.boot_entropy_thresh	= ATOMIC_INIT(LRNG_INIT_ENTROPY_BITS),
 	.reseed_in_progress	=
-		__MUTEX_INITIALIZER(lrng_state.reseed_in_progress),
+		__RWSEM_INITIALIZER(lrng_state.reseed_in_progress),
 };
 
 /*
@@ -139,17 +142,32 @@ void lrng_debug_report_seedlevel(const char *name)
  */
 int lrng_pool_trylock(void)
 {
-	return mutex_trylock(&lrng_state.reseed_in_progress);
+	return down_write_trylock(&lrng_state.reseed_in_progress);
 }
 
 void lrng_pool_lock(void)
 {
-	mutex_lock(&lrng_state.reseed_in_progress);
+	down_write(&lrng_state.reseed_in_progress);
 }
 
 void lrng_pool_unlock(void)
 {
-	mutex_unlock(&lrng_state.reseed_in_progress);
+	up_write(&lrng_state.reseed_in_progress);
+}
+
+/*
+ * Once the LRNG is operational, the reseeds of different DRNGs may read the
+ * LRNG pool concurrently as the entropy sources serialize the extraction of
+ * their entropy themselves. These readers take the lock shared.
+ */
+int lrng_pool_trylock_shared(void)
+{
+	return down_read_trylock(&lrng_state.reseed_in_progress);
+}
+
+void lrng_pool_unlock_shared(void)
+{
+	up_read(&lrng_state.reseed_in_progress);
 }
 
 /* Set new entropy threshold for reseeding during boot */
@@ -158,6 +176,77 @@ void lrng_set_entropy_thresh(u32 new_entropy_bits)
 	atomic_set(&lrng_state.boot_entropy_thresh, new_entropy_bits);
 }
 
+/*
+ * Static keys for the seeding states: The generate path checks the seeding
+ * states with every request although they only change once per boot in steady
+ * state. An enabled key reports the state without accessing the LRNG state.
+ * A disabled key falls back to the state variable which is always updated
+ * first. Thus, the transitions to a seeded state take effect immediately and
+ * the keys are patched later from process context. The reverse transitions,
+ * i.e. lrng_reset() and the initial DRNG losing its fully seeded state, may
+ * happen while holding locks which must not be held while patching the keys,
+ * e.g. lrng_crypto_cb_update. Thus, a reverse transition masks all enabled
+ * keys with lrng_state_keys_reverting before the keys are patched later from
+ * process context. While masked, the state checks fall back to the state
+ * variables such that a reverse transition takes effect immediately as well.
+ */
+DEFINE_STATIC_KEY_FALSE(lrng_state_min_seeded_key);
+DEFINE_STATIC_KEY_FALSE(lrng_state_fully_seeded_key);
+DEFINE_STATIC_KEY_FALSE(lrng_state_operational_key);
+atomic_t lrng_state_keys_reverting = ATOMIC_INIT(0);
+
+/* Serialize the key updates to always apply the latest state */
+static DEFINE_MUTEX(lrng_state_keys_lock);
+
+static void lrng_state_key_set(struct static_key_false *key, bool set)
+{
+	if (set)
+		static_branch_enable(key);
+	else
+		static_branch_disable(key);
+}
+
+static void lrng_state_keys_sync(struct work_struct *unused)
+{
+	int reverting;
+
+	mutex_lock(&lrng_state_keys_lock);
+	/* Read the pending reverse transitions before the state variables */
+	reverting = atomic_read_acquire(&lrng_state_keys_reverting);
+	lrng_state_key_set(&lrng_state_min_seeded_key,
+			   READ_ONCE(lrng_state.lrng_min_seeded));
+	lrng_state_key_set(&lrng_state_fully_seeded_key,
+			   READ_ONCE(lrng_state.lrng_fully_seeded));
+	lrng_state_key_set(&lrng_state_operational_key,
+			   READ_ONCE(lrng_state.lrng_operational));
+	/* Unmask the keys reverted by this update */
+	atomic_sub(reverting, &lrng_state_keys_reverting);
+	mutex_unlock(&lrng_state_keys_lock);
+}
+
+static DECLARE_WORK(lrng_state_keys_work, lrng_state_keys_sync);
+
+/* Update the static keys - the state variables must be set first */
+static void lrng_state_keys_update(void)
+{
+	/* Before lrng_rand_initialize, lrng_rand_initialize updates the keys */
+	if (lrng_state.perform_seedwork)
+		schedule_work(&lrng_state_keys_work);
+}
+
+/* Revert the static keys - the state variables must be cleared first */
+static void lrng_state_keys_revert(void)
+{
+	/* Before lrng_rand_initialize, no key is enabled */
+	if (!lrng_state.perform_seedwork)
+		return;
+
+	/* Mask the keys until the key work reverted them */
+	smp_mb__before_atomic();
+	atomic_inc(&lrng_state_keys_reverting);
+	schedule_work(&lrng_state_keys_work);
+}
+
 /*
  * Reset LRNG state - the entropy counters are reset, but the data that may
  * or may not have entropy remains in the pools as this data will not hurt.
@@ -175,6 +264,8 @@ void lrng_reset_state(void)
 	lrng_state.lrng_min_seeded = false;
 	lrng_state.all_online_numa_node_seeded = false;
 
+	lrng_state_keys_revert();
+
 #ifdef CONFIG_VDSO_GETRANDOM
 	WRITE_ONCE(__arch_get_k_vdso_rng_data()->is_ready, false);
 #endif
@@ -195,22 +286,19 @@ bool lrng_pool_all_numa_nodes_seeded_get(void)
 	return lrng_state.all_online_numa_node_seeded;
 }
 
-/* Return boolean whether LRNG reached minimally seed level */
-bool lrng_state_min_seeded(void)
+bool __lrng_state_min_seeded(void)
 {
-	return lrng_state.lrng_min_seeded;
+	return READ_ONCE(lrng_state.lrng_min_seeded);
 }
 
-/* Return boolean whether LRNG reached fully seed level */
-bool lrng_state_fully_seeded(void)
+bool __lrng_state_fully_seeded(void)
 {
-	return lrng_state.lrng_fully_seeded;
+	return READ_ONCE(lrng_state.lrng_fully_seeded);
 }
 
-/* Return boolean whether LRNG is considered fully operational */
-bool lrng_state_operational(void)
+bool __lrng_state_operational(void)
 {
-	return lrng_state.lrng_operational;
+	return READ_ONCE(lrng_state.lrng_operational);
 }
 
 static void lrng_init_wakeup(void)
@@ -223,6 +311,7 @@ static void lrng_init_wakeup(void)
 	/* WRITE_ONCE(__arch_get_k_vdso_rng_data()->is_ready, true); */
 #endif
 
+	lrng_state_keys_update();
 	wake_up_all(&lrng_init_wait);
 	lrng_init_wakeup_dev();
 	lrng_kick_random_ready();
@@ -288,6 +377,7 @@ void lrng_unset_fully_seeded(struct lrng_drng *drng)
 		pr_debug("LRNG set to non-operational\n");
 		lrng_state.lrng_operational = false;
 		lrng_state.lrng_fully_seeded = false;
+		lrng_state_keys_revert();
 
 #ifdef CONFIG_VDSO_GETRANDOM
 		WRITE_ONCE(__arch_get_k_vdso_rng_data()->is_ready, false);
@@ -445,6 +535,9 @@ void __init lrng_rand_initialize(void)
 	INIT_WORK(&lrng_state.lrng_seed_work, lrng_drng_seed_work);
 	lrng_state.perform_seedwork = true;
 
+	/* Apply the seeding states reached during early boot */
+	lrng_state_keys_update();
+
 	invalidate_batched_entropy();
 
 	lrng_state.can_invalidate = true;
@@ -471,6 +564,9 @@ void lrng_es_add_entropy(void)
 	if (likely(lrng_state.all_online_numa_node_seeded))
 		return;
 
+	/* Notify a waiting emergency seeding about the new entropy */
+	lrng_drng_es_notify();
+
 	/* Only trigger the DRNG reseed if we have collected entropy. */
 	if (lrng_avail_entropy() <
 	    atomic_read_u32(&lrng_state.boot_entropy_thresh))
@@ -487,9 +583,81 @@ void lrng_es_add_entropy(void)
 		lrng_drng_seed_work(NULL);
 }
 
-/* Fill the seed buffer with data from the noise sources */
+/* Concatenate the output of the entropy sources */
+static void lrng_fill_seed_buffer_es(struct entropy_buf *eb, u32 requested_bits,
+				     bool avail_only, int node)
+{
+	struct lrng_state *state = &lrng_state;
+	u32 i, ent_thresh = lrng_avail_entropy_thresh();
+
+	for_each_lrng_es(i) {
+		u64 start;
+
+		/*
+		 * The aux pool is always read as it mixes the seed buffer
+		 * back for backtracking resistance.
+		 */
+		if (avail_only && i != lrng_ext_es_aux &&
+		    !lrng_es[i]->curr_entropy(ent_thresh)) {
+			eb->e_bits[i] = 0;
+			eb->e_len[i] = 0;
+			continue;
+		}
+
+		start = trace_lrng_es_get_ent_enabled() ? ktime_get_ns() : 0;
+
+		lrng_es[i]->get_ent(eb, requested_bits,
+				    state->lrng_fully_seeded, node);
+
+		if (start)
+			trace_lrng_es_get_ent(lrng_es[i]->name, requested_bits,
+					      eb->e_bits[i],
+					      ktime_get_ns() - start);
+	}
+
+	/* allow external entropy provider to provide seed */
+	lrng_state_exseed_allow_all();
+}
+
+/*
+ * Encode the seed buffer into the compact seed record rec of
+ * LRNG_SEED_RECORD_MAX_BYTES. Only the data the entropy sources actually
+ * delivered is encoded with its delivered length. The aux pool data is
+ * encoded even without entropy as it may carry data not credited with entropy
+ * that stirs the DRNG. The record of a seed buffer filled without requesting
+ * entropy only holds the time stamp.
+ *
+ * Return: length of the seed record in bytes
+ */
+u32 lrng_seed_record(const struct entropy_buf *eb, u8 *rec)
+{
+	u32 i, slicelen, len = 0;
+
+	BUILD_BUG_ON(lrng_ext_es_last > U8_MAX ||
+		     LRNG_DRNG_INIT_SEED_SIZE_BYTES > U8_MAX);
+
+	for_each_lrng_es(i) {
+		slicelen = min_t(u32, eb->e_len[i],
+				 LRNG_DRNG_INIT_SEED_SIZE_BYTES);
+		if (!slicelen)
+			continue;
+
+		rec[len++] = (u8)i;
+		rec[len++] = (u8)slicelen;
+		memcpy(rec + len, eb->e[i], slicelen);
+		len += slicelen;
+	}
+
+	memcpy(rec + len, &eb->now, sizeof(eb->now));
+	return len + sizeof(eb->now);
+}
+
+/*
+ * Fill the seed buffer with data from the noise sources. The entropy sources
+ * with per-CPU state prefer the state of the CPUs on the given NUMA node.
+ */
 void lrng_fill_seed_buffer(struct entropy_buf *eb, u32 requested_bits,
-			   bool force)
+			   bool force, int node)
 {
 	struct lrng_state *state = &lrng_state;
 	u32 i, req_ent = lrng_sp80090c_compliant() ?
@@ -505,24 +673,33 @@ void lrng_fill_seed_buffer(struct entropy_buf *eb, u32 requested_bits,
 	 * Require at least 128 bits of entropy for any reseed. If the LRNG is
 	 * operated SP800-90C compliant we want to comply with SP800-90A section
 	 * 9.2 mandating that DRNG is reseeded with the security strength.
+	 * A request for no entropy only provides the time stamp.
 	 */
-	if (!force &&
-	    state->lrng_fully_seeded && (lrng_avail_entropy() < req_ent)) {
-		for_each_lrng_es(i)
+	if (!requested_bits ||
+	    (!force &&
+	     state->lrng_fully_seeded && (lrng_avail_entropy() < req_ent))) {
+		for_each_lrng_es(i) {
 			eb->e_bits[i] = 0;
+			eb->e_len[i] = 0;
+		}
 
 		goto wakeup;
 	}
 
-	/* Concatenate the output of the entropy sources. */
-	for_each_lrng_es(i) {
-		lrng_es[i]->get_ent(eb, requested_bits,
-				    state->lrng_fully_seeded);
-	}
-
-	/* allow external entropy provider to provide seed */
-	lrng_state_exseed_allow_all();
+	lrng_fill_seed_buffer_es(eb, requested_bits, false, node);
 
 wakeup:
 	lrng_writer_wakeup();
 }
+
+/*
+ * Fill the seed buffer only with data from the entropy sources which report
+ * available entropy, e.g. for the repeated passes of the emergency seeding.
+ */
+void lrng_fill_seed_buffer_avail(struct entropy_buf *eb, u32 requested_bits,
+				 int node)
+{
+	eb->now = random_get_entropy();
+	lrng_fill_seed_buffer_es(eb, requested_bits, true, node);
+	lrng_writer_wakeup();
+}
@@ -6,6 +6,8 @@
 #ifndef _LRNG_ES_MGR_H
 #define _LRNG_ES_MGR_H
 
+#include <linux/jump_label.h>
+
 #include "lrng_es_mgr_cb.h"
 
 /*************************** General LRNG parameter ***************************/
@@ -26,11 +28,42 @@ extern struct lrng_es_cb *lrng_es[];
 bool lrng_enforce_panic_on_permanent_health_failure(void);
 bool lrng_ntg1_2024_compliant(void);
 bool lrng_pool_all_numa_nodes_seeded_get(void);
-bool lrng_state_min_seeded(void);
 void lrng_debug_report_seedlevel(const char *name);
 void lrng_rand_initialize_early(void);
 void lrng_rand_initialize(void);
-bool lrng_state_operational(void);
+
+DECLARE_STATIC_KEY_FALSE(lrng_state_min_seeded_key);
+DECLARE_STATIC_KEY_FALSE(lrng_state_fully_seeded_key);
+DECLARE_STATIC_KEY_FALSE(lrng_state_operational_key);
+extern atomic_t lrng_state_keys_reverting;
+
+bool __lrng_state_min_seeded(void);
+bool __lrng_state_fully_seeded(void);
+bool __lrng_state_operational(void);
+
+/* Return boolean whether LRNG reached minimally seed level */
+static inline bool lrng_state_min_seeded(void)
+{
+	return (static_branch_likely(&lrng_state_min_seeded_key) &&
+		!atomic_read(&lrng_state_keys_reverting)) ||
+	       __lrng_state_min_seeded();
+}
+
+/* Return boolean whether LRNG reached fully seed level */
+static inline bool lrng_state_fully_seeded(void)
+{
+	return (static_branch_likely(&lrng_state_fully_seeded_key) &&
+		!atomic_read(&lrng_state_keys_reverting)) ||
+	       __lrng_state_fully_seeded();
+}
+
+/* Return boolean whether LRNG is considered fully operational */
+static inline bool lrng_state_operational(void)
+{
+	return (static_branch_likely(&lrng_state_operational_key) &&
+		!atomic_read(&lrng_state_keys_reverting)) ||
+	       __lrng_state_operational();
+}
 
 extern u32 lrng_write_wakeup_bits;
 void lrng_set_entropy_thresh(u32 new);
@@ -38,11 +71,11 @@ u32 lrng_avail_entropy(void);
 u32 lrng_avail_entropy_aux(void);
 void lrng_reset_state(void);
 
-bool lrng_state_fully_seeded(void);
-
 int lrng_pool_trylock(void);
 void lrng_pool_lock(void);
 void lrng_pool_unlock(void);
+int lrng_pool_trylock_shared(void);
+void lrng_pool_unlock_shared(void);
 void lrng_pool_all_numa_nodes_seeded(bool set);
 
 bool lrng_fully_seeded(bool fully_seeded, u32 collected_entropy,
@@ -50,7 +83,10 @@ bool lrng_fully_seeded(bool fully_seeded, u32 collected_entropy,
 u32 lrng_entropy_rate_eb(struct entropy_buf *eb);
 void lrng_unset_fully_seeded(struct lrng_drng *drng);
 void lrng_fill_seed_buffer(struct entropy_buf *eb, u32 requested_bits,
-			   bool force);
+			   bool force, int node);
+void lrng_fill_seed_buffer_avail(struct entropy_buf *eb, u32 requested_bits,
+				 int node);
+u32 lrng_seed_record(const struct entropy_buf *eb, u8 *rec);
 void lrng_init_ops(struct entropy_buf *eb);
 
 #endif /* _LRNG_ES_MGR_H */
@@ -38,17 +38,33 @@ enum lrng_external_es {
 	lrng_ext_es_last			/* MUST be the last entry */
 };
 
+/*
+ * Seed buffer: e_bits holds the entropy and e_len the number of data bytes
+ * an entropy source delivered into its slice e.
+ */
 struct entropy_buf {
 	u8 e[lrng_ext_es_last][LRNG_DRNG_INIT_SEED_SIZE_BYTES];
-	u32 now, e_bits[lrng_ext_es_last];
+	u32 now, e_bits[lrng_ext_es_last], e_len[lrng_ext_es_last];
 };
 
+/*
+ * Compact seed record generated from struct entropy_buf: every entropy source
+ * contributing to the seed is encoded with a one-byte tag holding its index, a
+ * one-byte length and the delivered data. The time stamp of the seed buffer
+ * concludes the record.
+ */
+#define LRNG_SEED_RECORD_MAX_BYTES					\
+	(lrng_ext_es_last * (LRNG_DRNG_INIT_SEED_SIZE_BYTES + 2) + sizeof(u32))
+
 /*
  * struct lrng_es_cb - callback defining an entropy source
  * @name: Name of the entropy source.
  * @get_ent: Fetch entropy into the entropy_buf. The ES shall only deliver
  *	     data if its internal initialization is complete, including any
- *	     SP800-90B startup testing or similar.
+ *	     SP800-90B startup testing or similar. An ES maintaining per-CPU
+ *	     state may prefer the state of the CPUs on the given NUMA node
+ *	     (NUMA_NO_NODE for no preference). The ES shall set both the
+ *	     entropy and the length of the delivered data.
  * @curr_entropy: Return amount of currently available entropy.
  * @max_entropy: Maximum amount of entropy the entropy source is able to
  *		 maintain.
@@ -61,7 +77,7 @@ struct entropy_buf {
 struct lrng_es_cb {
 	const char *name;
 	void (*get_ent)(struct entropy_buf *eb, u32 requested_bits,
-			bool fully_seeded);
+			bool fully_seeded, int node);
 	u32 (*curr_entropy)(u32 requested_bits);
 	u32 (*max_entropy)(void);
 	void (*state)(unsigned char *buf, size_t buflen);
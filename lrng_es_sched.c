@@ -301,9 +301,11 @@ lrng_sched_pool_hash_one(const struct lrng_hash_cb *pcpu_hash_cb,
  * @eb: entropy buffer to store entropy
  * @requested_bits: Requested amount of entropy
  * @fully_seeded: indicator whether LRNG is fully seeded
+ * @node: NUMA node whose per-CPU pools are harvested first, the remote pools
+ *	  are only harvested if the local pools do not suffice
  */
 static void lrng_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits,
-				 bool fully_seeded)
+				 bool fully_seeded, int node)
 {
 	SHASH_DESC_ON_STACK(shash, NULL);
 	const struct lrng_hash_cb *hash_cb;
@@ -315,10 +317,12 @@ static void lrng_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 	    requested_events, returned_ent_bits;
 	int ret, cpu;
 	void *hash;
+	bool remote = (node == NUMA_NO_NODE);
 
 	/* Only deliver entropy when SP800-90B self test is completed */
 	if (!lrng_sp80090b_startup_complete_es(lrng_int_es_sched)) {
 		eb->e_bits[lrng_int_es_sched] = 0;
+		eb->e_len[lrng_int_es_sched] = 0;
 		return;
 	}
 
@@ -341,15 +345,22 @@ static void lrng_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 
 	/*
 	 * Harvest entropy from each per-CPU hash state - even though we may
-	 * have collected sufficient entropy, we will hash all per-CPU pools.
+	 * have collected sufficient entropy, we will hash all per-CPU pools of
+	 * the pass. The pools of the remote CPUs are only harvested if the
+	 * pools of the CPUs on the preferred NUMA node do not suffice.
 	 */
+again:
 	for_each_online_cpu(cpu) {
 		struct lrng_drng *pcpu_drng = drng;
 		u32 digestsize, unused_events = 0;
-		int node = cpu_to_node(cpu);
+		int cpu_node = cpu_to_node(cpu);
 
-		if (lrng_drng && lrng_drng[node])
-			pcpu_drng = lrng_drng[node];
+		if (!lrng_pcpu_pool_in_pass(cpu, node, remote))
+			continue;
+
+		/* The DRNG of the node may go online or offline concurrently */
+		if (lrng_drng)
+			pcpu_drng = READ_ONCE(lrng_drng[cpu_node]) ?: drng;
 
 		if (pcpu_drng == drng) {
 			found_events = lrng_sched_pool_hash_one(hash_cb, hash,
@@ -380,6 +391,12 @@ static void lrng_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 			 found_events - unused_events, cpu, unused_events);
 	}
 
+	/* Fall back to the remote pools if the local entropy is short */
+	if (!remote && collected_events < requested_events) {
+		remote = true;
+		goto again;
+	}
+
 	ret = hash_cb->hash_final(shash, digest);
 	if (ret)
 		goto err;
@@ -402,8 +419,9 @@ static void lrng_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits,
 	 * estimate underestimates the available entropy we can transport as
 	 * much available entropy as possible.
 	 */
-	memcpy(eb->e[lrng_int_es_sched], digest,
-	       fully_seeded ? returned_ent_bits >> 3 : requested_bits >> 3);
+	eb->e_len[lrng_int_es_sched] = fully_seeded ? returned_ent_bits >> 3 :
+				       requested_bits >> 3;
+	memcpy(eb->e[lrng_int_es_sched], digest, eb->e_len[lrng_int_es_sched]);
 	eb->e_bits[lrng_int_es_sched] = returned_ent_bits;
 
 out:
@@ -414,6 +432,7 @@ out:
 
 err:
 	eb->e_bits[lrng_int_es_sched] = 0;
+	eb->e_len[lrng_int_es_sched] = 0;
 	goto out;
 }
 
@@ -15,6 +15,16 @@ u32 lrng_gcd_analyze(u32 *history, size_t nelem);
 void lrng_gcd_add_value(u32 time);
 bool lrng_highres_timer(void);
 
+/*
+ * Is the per-CPU pool of the CPU harvested in the current pass? If a NUMA
+ * node is preferred, the first pass harvests the pools of the CPUs on that
+ * node and the second pass the pools of the remote CPUs.
+ */
+static inline bool lrng_pcpu_pool_in_pass(int cpu, int node, bool remote)
+{
+	return node == NUMA_NO_NODE || (cpu_to_node(cpu) != node) == remote;
+}
+
 /*
  * To limit the impact on the interrupt handling, the LRNG concatenates
  * entropic LSB parts of the time stamps in a per-CPU array and only
@@ -35,7 +35,7 @@ static void _lrng_kcapi_hash_free(struct lrng_hash_info *lrng_hash)
 	kfree(lrng_hash);
 }
 
-static void *lrng_kcapi_hash_alloc(const char *name)
+static void *lrng_kcapi_hash_alloc(const char *name, int node)
 {
 	struct lrng_hash_info *lrng_hash;
 	struct crypto_shash *tfm;
@@ -53,7 +53,7 @@ static void *lrng_kcapi_hash_alloc(const char *name)
 	}
 
 	ret = sizeof(struct lrng_hash_info);
-	lrng_hash = kmalloc(ret, GFP_KERNEL);
+	lrng_hash = kmalloc_node(ret, GFP_KERNEL, node);
 	if (!lrng_hash) {
 		crypto_free_shash(tfm);
 		return ERR_PTR(-ENOMEM);
@@ -66,9 +66,9 @@ static void *lrng_kcapi_hash_alloc(const char *name)
 	return lrng_hash;
 }
 
-static void *lrng_kcapi_hash_name_alloc(void)
+static void *lrng_kcapi_hash_name_alloc(int node)
 {
-	return lrng_kcapi_hash_alloc(lrng_kcapi_hash_name());
+	return lrng_kcapi_hash_alloc(lrng_kcapi_hash_name(), node);
 }
 
 static u32 lrng_kcapi_hash_digestsize(void *hash)
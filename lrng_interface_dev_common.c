@@ -7,6 +7,7 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/mm.h>
 #include <linux/random.h>
 #include <linux/slab.h>
 
@@ -15,6 +16,24 @@
 #include "lrng_es_mgr.h"
 #include "lrng_interface_dev_common.h"
 
+/*
+ * RNDADDENTROPYV
+ *
+ * Batched version of RNDADDENTROPY: the caller provides a vector of records
+ * each holding a data buffer and the entropy claimed for it. All records are
+ * inserted into the auxiliary pool with one system call and one reseed
+ * decision. The entropy credited for each record is returned in the
+ * credited_count field of the respective record.
+ *
+ * The IOCTL number and the struct lrng_rand_pool_vec argument are defined in
+ * include/uapi/linux/random.h by the patch adding the IOCTL to the kernel.
+ * Without that patch, the IOCTL is not compiled and thus not offered.
+ * At most LRNG_RNDADDENTROPYV_MAX_RECS records with an accumulated data size
+ * of at most LRNG_RNDADDENTROPYV_MAX_BYTES are processed with one call.
+ */
+#define LRNG_RNDADDENTROPYV_MAX_RECS	64
+#define LRNG_RNDADDENTROPYV_MAX_BYTES	(1<<16)
+
 DECLARE_WAIT_QUEUE_HEAD(lrng_write_wait);
 static struct fasync_struct *fasync;
 
@@ -109,11 +128,17 @@ ssize_t lrng_read_common(char __user *buf, size_t nbytes, bool pr)
 	/*
 	 * Satisfy large read requests -- as the common case are smaller
 	 * request sizes, such as 16 or 32 bytes, avoid a kmalloc overhead for
-	 * those by using the stack variable of tmpbuf.
+	 * those by using the stack variable of tmpbuf. The buffer size follows
+	 * the request size of the DRNG to generate large requests with few
+	 * DRNG operations. As the request size of a DRNG may be large, e.g. 64
+	 * KiB for the DRBG, the buffer is allocated with kvmalloc to not
+	 * require a high-order allocation.
 	 */
 	if (!IS_ENABLED(CONFIG_BASE_SMALL) && (nbytes > sizeof(tmpbuf))) {
-		tmplen = min_t(u32, nbytes, LRNG_DRNG_MAX_REQSIZE);
-		tmp_large = kmalloc(tmplen + LRNG_KCAPI_ALIGN, GFP_KERNEL);
+		tmplen = lrng_drng_reqsize(lrng_drng_node_instance());
+		tmplen = min_t(u32, nbytes,
+			       max_t(u32, tmplen, LRNG_DRNG_MAX_REQSIZE));
+		tmp_large = kvmalloc(tmplen + LRNG_KCAPI_ALIGN, GFP_KERNEL);
 		if (!tmp_large)
 			tmplen = sizeof(tmpbuf);
 		else
@@ -152,7 +177,7 @@ ssize_t lrng_read_common(char __user *buf, size_t nbytes, bool pr)
 
 	/* Wipe data just returned from memory */
 	if (tmp_large)
-		kfree_sensitive(tmp_large);
+		kvfree_sensitive(tmp_large, tmplen + LRNG_KCAPI_ALIGN);
 	else
 		memzero_explicit(tmpbuf, sizeof(tmpbuf));
 
@@ -232,7 +257,7 @@ ssize_t lrng_drng_write_common(const char __user *buffer, size_t count,
 
 	/* Force reseed of DRNG during next data request. */
 	if (!orig_entropy_bits)
-		lrng_drng_force_reseed();
+		lrng_drng_force_reseed_nodes();
 
 	return ret;
 }
@@ -243,6 +268,110 @@ ssize_t lrng_drng_write(struct file *file, const char __user *buffer,
 	return lrng_drng_write_common(buffer, count, 0);
 }
 
+#ifdef RNDADDENTROPYV
+static long lrng_ioctl_addentropy_vec(void __user *arg)
+{
+	struct lrng_rand_pool_vec vec;
+	struct lrng_rand_pool_rec __user *urecs;
+	struct lrng_rand_pool_rec *recs = NULL;
+	struct lrng_aux_rec *aux = NULL;
+	u8 *data = NULL, *p;
+	size_t total = 0;
+	u32 i, claimed_bits = 0;
+	long ret;
+
+	if (copy_from_user(&vec, arg, sizeof(vec)))
+		return -EFAULT;
+	if (vec.flags)
+		return -EINVAL;
+	if (!vec.nr_recs)
+		return 0;
+	if (vec.nr_recs > LRNG_RNDADDENTROPYV_MAX_RECS)
+		return -E2BIG;
+
+	if (!lrng_get_available()) {
+		ret = lrng_drng_initalize();
+		if (ret)
+			return ret;
+	}
+
+	urecs = u64_to_user_ptr(vec.recs);
+	recs = kcalloc(vec.nr_recs, sizeof(*recs), GFP_KERNEL);
+	aux = kcalloc(vec.nr_recs, sizeof(*aux), GFP_KERNEL);
+	if (!recs || !aux) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (copy_from_user(recs, urecs, vec.nr_recs * sizeof(*recs))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	for (i = 0; i < vec.nr_recs; i++) {
+		if (recs[i].reserved) {
+			ret = -EINVAL;
+			goto out;
+		}
+		if (recs[i].buf_size > LRNG_RNDADDENTROPYV_MAX_BYTES - total) {
+			ret = -E2BIG;
+			goto out;
+		}
+		total += recs[i].buf_size;
+	}
+
+	if (total) {
+		data = kmalloc(total, GFP_KERNEL);
+		if (!data) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	/* Fetch all data before touching the aux pool */
+	for (i = 0, p = data; i < vec.nr_recs; i++) {
+		u32 size = recs[i].buf_size;
+
+		if (size &&
+		    copy_from_user(p, u64_to_user_ptr(recs[i].buf), size)) {
+			ret = -EFAULT;
+			goto out;
+		}
+
+		aux[i].buf = p;
+		aux[i].len = size;
+		/* there cannot be more entropy than data */
+		aux[i].entropy_bits = min_t(u32, recs[i].entropy_count,
+					    size << 3);
+		claimed_bits += aux[i].entropy_bits;
+		p += size;
+	}
+
+	/*
+	 * The records inserted before a failing record remain credited. Report
+	 * their credited entropy in any case.
+	 */
+	ret = lrng_pool_insert_aux_vec(aux, vec.nr_recs);
+
+	for (i = 0; i < vec.nr_recs; i++)
+		recs[i].credited_count = aux[i].credited_bits;
+	if (copy_to_user(urecs, recs, vec.nr_recs * sizeof(*recs))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* Force reseed of DRNG during next data request. */
+	if (!ret && !claimed_bits)
+		lrng_drng_force_reseed();
+
+out:
+	kfree_sensitive(data);
+	kfree(aux);
+	kfree(recs);
+	return ret;
+}
+#endif
+
 long lrng_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
 	u32 digestsize_bits;
@@ -284,6 +413,12 @@ long lrng_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 		ret = lrng_drng_write_common((const char __user *)p, size,
 					     ent_count_bits);
 		return (ret < 0) ? ret : 0;
+#ifdef RNDADDENTROPYV
+	case RNDADDENTROPYV:
+		if (!capable(CAP_SYS_ADMIN))
+			return -EPERM;
+		return lrng_ioctl_addentropy_vec((void __user *)arg);
+#endif
 	case RNDZAPENTCNT:
 	case RNDCLEARPOOL:
 		/* Clear the entropy pool counter. */
@@ -32,7 +32,7 @@ static int lrng_kcapi_if_reseed(const u8 *src, unsigned int slen)
 		return ret;
 
 	/* Make sure the new data is immediately available to DRNG */
-	lrng_drng_force_reseed();
+	lrng_drng_force_reseed_nodes();
 
 	return 0;
 }
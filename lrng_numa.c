@@ -7,7 +7,10 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
 #include <linux/lrng.h>
+#include <linux/memory.h>
 #include <linux/slab.h>
 
 #include "lrng_drng_mgr.h"
@@ -18,12 +21,248 @@
 
 static struct lrng_drng **lrng_drng __read_mostly = NULL;
 
+/*
+ * DRNG instances of NUMA nodes which lost all their memory and CPUs. The
+ * readers access the per-NUMA node DRNG instances without a lock and the
+ * per-CPU entropy pools of the node may still refer to the hash of the DRNG.
+ * Thus, a DRNG instance of a node going offline is never released, but
+ * retained for the node coming online again. Protected by
+ * lrng_crypto_cb_update.
+ */
+static struct lrng_drng **lrng_drng_offline = NULL;
+
 struct lrng_drng **lrng_drng_instances(void)
 {
 	/* counterpart to cmpxchg_release in _lrng_drngs_numa_alloc */
 	return READ_ONCE(lrng_drng);
 }
 
+struct lrng_drng **lrng_drng_offline_instances(void)
+{
+	return lrng_drng_offline;
+}
+
+/* Does the NUMA node have memory or online CPUs served by a DRNG? */
+static bool lrng_numa_node_populated(int node)
+{
+	return node_online(node) &&
+	       (node_state(node, N_MEMORY) ||
+		cpumask_intersects(cpumask_of_node(node), cpu_online_mask));
+}
+
+/*
+ * Bring the DRNG instances of one type in line with the populated NUMA nodes.
+ * A node which is populated after the boot-time allocation receives a DRNG
+ * instance - either the one retained when the node went offline or a newly
+ * allocated one. The DRNG instance of a node which went offline is
+ * unpublished and retained. The DRNG allocated during boot is never retired
+ * as it is the fallback for all nodes. Caller must hold
+ * lrng_crypto_cb_update.
+ *
+ * Return: number of DRNG instances brought online minus the number of DRNG
+ *	   instances retired
+ */
+static int lrng_drngs_numa_update_type(struct lrng_drng **drngs,
+				       struct lrng_drng **offline,
+				       struct lrng_drng *boot_drng,
+				       struct lrng_drng *(*alloc)(int node))
+{
+	int node, changed = 0;
+
+	for_each_node(node) {
+		struct lrng_drng *drng = drngs[node];
+
+		if (lrng_numa_node_populated(node)) {
+			if (drng)
+				continue;
+
+			drng = offline[node];
+			if (drng) {
+				offline[node] = NULL;
+			} else {
+				drng = alloc(node);
+				if (!drng) {
+					pr_warn("cannot allocate DRNG for NUMA node %d\n",
+						node);
+					continue;
+				}
+			}
+
+			/* Reseed from the entropy sources before first use */
+			lrng_drng_lock_reset(drng);
+
+			/* counterpart to READ_ONCE of the DRNG readers */
+			smp_store_release(&drngs[node], drng);
+			changed++;
+			pr_info("DRNG for NUMA node %d online\n", node);
+		} else if (drng && drng != boot_drng) {
+			WRITE_ONCE(drngs[node], NULL);
+
+			/* Readers still holding the instance must reseed it */
+			lrng_drng_lock_reset(drng);
+
+			offline[node] = drng;
+			changed--;
+			pr_info("DRNG for NUMA node %d offline\n", node);
+		}
+	}
+
+	return changed;
+}
+
+#ifdef CONFIG_LRNG_DRNG_NUMA_PR
+static struct lrng_drng **lrng_drng_pr_nodes __read_mostly = NULL;
+
+static struct lrng_drng **lrng_drng_pr_offline = NULL;
+
+struct lrng_drng **lrng_drng_pr_instances(void)
+{
+	/* counterpart to cmpxchg_release in lrng_drngs_pr_numa_alloc */
+	return READ_ONCE(lrng_drng_pr_nodes);
+}
+
+struct lrng_drng **lrng_drng_pr_offline_instances(void)
+{
+	return lrng_drng_pr_offline;
+}
+
+/* Allocate the prediction resistance DRNG for the NUMA node */
+static struct lrng_drng *lrng_drng_pr_numa_alloc_one(int node)
+{
+	struct lrng_drng *lrng_drng_pr = lrng_drng_pr_instance();
+	struct lrng_drng *drng;
+
+	drng = kzalloc_node(sizeof(struct lrng_drng), GFP_KERNEL, node);
+	if (!drng)
+		return NULL;
+
+	mutex_init(&drng->lock);
+	rwlock_init(&drng->hash_lock);
+	spin_lock_init(&drng->spin_lock);
+	INIT_LIST_HEAD(&drng->pr_queue);
+	drng->hash_cb = lrng_drng_pr->hash_cb;
+	drng->node = node;
+	drng->pr = true;
+
+	if (lrng_drng_alloc_common(drng, lrng_drng_pr->drng_cb, node)) {
+		kfree(drng);
+		return NULL;
+	}
+
+	return drng;
+}
+
+/*
+ * Allocate the per-NUMA node prediction resistance DRNGs. The first online
+ * node uses the prediction resistance DRNG allocated during boot. The
+ * prediction resistance DRNGs do not need a hash as they are seeded from the
+ * entropy sources with the hash of the regular DRNG of the NUMA node. Caller
+ * must hold lrng_crypto_cb_update.
+ */
+static void lrng_drngs_pr_numa_alloc(void)
+{
+	struct lrng_drng *lrng_drng_pr = lrng_drng_pr_instance();
+	struct lrng_drng **drngs;
+	u32 node;
+	bool pr_drng_used = false;
+
+	/* per-NUMA-node prediction resistance DRNGs are already present */
+	if (lrng_drng_pr_nodes)
+		return;
+
+	drngs = kcalloc(nr_node_ids, sizeof(void *), GFP_KERNEL);
+	if (!drngs)
+		return;
+
+	for_each_online_node(node) {
+		struct lrng_drng *drng;
+
+		if (!pr_drng_used) {
+			drngs[node] = lrng_drng_pr;
+			pr_drng_used = true;
+			continue;
+		}
+
+		drng = lrng_drng_pr_numa_alloc_one(node);
+		if (!drng)
+			goto err;
+
+		drngs[node] = drng;
+
+		pr_info("prediction resistance DRNG for NUMA node %d allocated\n",
+			node);
+	}
+
+	/* counterpart to READ_ONCE in lrng_drng_pr_instances */
+	if (!cmpxchg_release(&lrng_drng_pr_nodes, NULL, drngs))
+		return;
+
+err:
+	for_each_online_node(node) {
+		struct lrng_drng *drng = drngs[node];
+
+		if (drng && drng != lrng_drng_pr) {
+			drng->drng_cb->drng_dealloc(drng->drng);
+			kfree(drng);
+		}
+	}
+	kfree(drngs);
+}
+
+/* Caller must hold lrng_crypto_cb_update */
+static void lrng_drngs_pr_numa_update(void)
+{
+	if (!lrng_drng_pr_nodes)
+		return;
+
+	if (!lrng_drng_pr_offline)
+		lrng_drng_pr_offline = kcalloc(nr_node_ids, sizeof(void *),
+					       GFP_KERNEL|__GFP_NOFAIL);
+
+	lrng_drngs_numa_update_type(lrng_drng_pr_nodes, lrng_drng_pr_offline,
+				    lrng_drng_pr_instance(),
+				    lrng_drng_pr_numa_alloc_one);
+}
+#else /* CONFIG_LRNG_DRNG_NUMA_PR */
+static inline void lrng_drngs_pr_numa_alloc(void) { }
+static inline void lrng_drngs_pr_numa_update(void) { }
+#endif /* CONFIG_LRNG_DRNG_NUMA_PR */
+
+/* Allocate the DRNG and the entropy pool read hash for the NUMA node */
+static struct lrng_drng *lrng_drng_numa_alloc_one(int node)
+{
+	struct lrng_drng *lrng_drng_init = lrng_drng_init_instance();
+	struct lrng_drng *drng;
+
+	drng = kmalloc_node(sizeof(struct lrng_drng), GFP_KERNEL|__GFP_NOFAIL,
+			    node);
+	memset(drng, 0, sizeof(*drng));
+	drng->node = node;
+
+	if (lrng_drng_alloc_common(drng, lrng_drng_init->drng_cb, node)) {
+		kfree(drng);
+		return NULL;
+	}
+
+	/* Only the initial DRNG harvests the entropy sources */
+	if (IS_ENABLED(CONFIG_LRNG_DRNG_SEED_TREE))
+		drng->seed_root = lrng_drng_init;
+
+	drng->hash_cb = lrng_drng_init->hash_cb;
+	drng->hash = lrng_drng_init->hash_cb->hash_alloc(node);
+	if (IS_ERR(drng->hash)) {
+		lrng_drng_init->drng_cb->drng_dealloc(drng->drng);
+		kfree(drng);
+		return NULL;
+	}
+
+	mutex_init(&drng->lock);
+	rwlock_init(&drng->hash_lock);
+	spin_lock_init(&drng->spin_lock);
+
+	return drng;
+}
+
 /* Allocate the data structures for the per-NUMA node DRNGs */
 static void _lrng_drngs_numa_alloc(struct work_struct *work)
 {
@@ -52,25 +291,9 @@ static void _lrng_drngs_numa_alloc(struct work_struct *work)
 			continue;
 		}
 
-		drng = kmalloc_node(sizeof(struct lrng_drng),
-				    GFP_KERNEL|__GFP_NOFAIL, node);
-		memset(drng, 0, sizeof(lrng_drng));
-
-		if (lrng_drng_alloc_common(drng, lrng_drng_init->drng_cb)) {
-			kfree(drng);
-			goto err;
-		}
-
-		drng->hash_cb = lrng_drng_init->hash_cb;
-		drng->hash = lrng_drng_init->hash_cb->hash_alloc();
-		if (IS_ERR(drng->hash)) {
-			lrng_drng_init->drng_cb->drng_dealloc(drng->drng);
-			kfree(drng);
+		drng = lrng_drng_numa_alloc_one(node);
+		if (!drng)
 			goto err;
-		}
-
-		mutex_init(&drng->lock);
-		rwlock_init(&drng->hash_lock);
 
 		/*
 		 * No reseeding of NUMA DRNGs from previous DRNGs as this
@@ -86,6 +309,7 @@ static void _lrng_drngs_numa_alloc(struct work_struct *work)
 	/* counterpart to READ_ONCE in lrng_drng_instances */
 	if (!cmpxchg_release(&lrng_drng, NULL, drngs)) {
 		lrng_pool_all_numa_nodes_seeded(false);
+		lrng_drngs_pr_numa_alloc();
 		goto unlock;
 	}
 
@@ -115,8 +339,80 @@ static void lrng_drngs_numa_alloc(void)
 	schedule_work(&lrng_drngs_numa_alloc_work);
 }
 
+/*
+ * Create or retire the per-NUMA node DRNGs after a NUMA node gained or lost
+ * its memory or CPUs. The new DRNG instances are seeded by the regular seeding
+ * operation of all not fully seeded DRNGs.
+ */
+static void lrng_drngs_numa_update(struct work_struct *work)
+{
+	int changed;
+
+	/* Obtain a stable view of the online CPUs */
+	cpus_read_lock();
+	mutex_lock(&lrng_crypto_cb_update);
+
+	/* The boot-time allocation covers all nodes populated until then */
+	if (!lrng_drng)
+		goto unlock;
+
+	if (!lrng_drng_offline)
+		lrng_drng_offline = kcalloc(nr_node_ids, sizeof(void *),
+					    GFP_KERNEL|__GFP_NOFAIL);
+
+	changed = lrng_drngs_numa_update_type(lrng_drng, lrng_drng_offline,
+					      lrng_drng_init_instance(),
+					      lrng_drng_numa_alloc_one);
+	for (; changed > 0; changed--)
+		lrng_pool_inc_numa_node();
+	for (; changed < 0; changed++)
+		lrng_pool_dec_numa_node();
+
+	lrng_drngs_pr_numa_update();
+
+	/* Trigger the seeding of the new DRNG instances */
+	lrng_pool_all_numa_nodes_seeded(false);
+
+unlock:
+	mutex_unlock(&lrng_crypto_cb_update);
+	cpus_read_unlock();
+}
+
+static DECLARE_WORK(lrng_drngs_numa_update_work, lrng_drngs_numa_update);
+
+static int lrng_numa_cpu_notify(unsigned int cpu)
+{
+	schedule_work(&lrng_drngs_numa_update_work);
+	return 0;
+}
+
+static int lrng_numa_memory_notify(struct notifier_block *nb,
+				   unsigned long action, void *arg)
+{
+	if (action == MEM_ONLINE || action == MEM_OFFLINE)
+		schedule_work(&lrng_drngs_numa_update_work);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lrng_numa_memory_nb = {
+	.notifier_call = lrng_numa_memory_notify,
+};
+
 static int __init lrng_numa_init(void)
 {
+	int ret;
+
+	/* Register first to not miss a hotplug event before the allocation */
+	ret = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "lrng/numa:online",
+					lrng_numa_cpu_notify,
+					lrng_numa_cpu_notify);
+	if (ret < 0)
+		pr_warn("cannot register CPU hotplug handler: %d\n", ret);
+
+	ret = register_memory_notifier(&lrng_numa_memory_nb);
+	if (ret)
+		pr_warn("cannot register memory hotplug handler: %d\n", ret);
+
 	lrng_drngs_numa_alloc();
 	return 0;
 }
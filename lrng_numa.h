@@ -8,8 +8,24 @@
 
 #ifdef CONFIG_NUMA
 struct lrng_drng **lrng_drng_instances(void);
+struct lrng_drng **lrng_drng_offline_instances(void);
 #else	/* CONFIG_NUMA */
 static inline struct lrng_drng **lrng_drng_instances(void) { return NULL; }
+static inline struct lrng_drng **lrng_drng_offline_instances(void)
+{
+	return NULL;
+}
 #endif /* CONFIG_NUMA */
 
+#ifdef CONFIG_LRNG_DRNG_NUMA_PR
+struct lrng_drng **lrng_drng_pr_instances(void);
+struct lrng_drng **lrng_drng_pr_offline_instances(void);
+#else	/* CONFIG_LRNG_DRNG_NUMA_PR */
+static inline struct lrng_drng **lrng_drng_pr_instances(void) { return NULL; }
+static inline struct lrng_drng **lrng_drng_pr_offline_instances(void)
+{
+	return NULL;
+}
+#endif /* CONFIG_LRNG_DRNG_NUMA_PR */
+
 #endif /* _LRNG_NUMA_H */
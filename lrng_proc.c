@@ -13,6 +13,7 @@
 #include "lrng_drng_mgr.h"
 #include "lrng_es_aux.h"
 #include "lrng_es_mgr.h"
+#include "lrng_numa.h"
 #include "lrng_proc.h"
 
 /* Number of online DRNGs */
@@ -23,10 +24,15 @@ void lrng_pool_inc_numa_node(void)
 	numa_drngs++;
 }
 
+void lrng_pool_dec_numa_node(void)
+{
+	numa_drngs--;
+}
+
 static int lrng_proc_type_show(struct seq_file *m, void *v)
 {
 	struct lrng_drng *lrng_drng_init = lrng_drng_init_instance();
-	unsigned char buf[270];
+	unsigned char buf[384];
 	u32 i;
 
 	mutex_lock(&lrng_drng_init->lock);
@@ -65,9 +71,73 @@ static int lrng_proc_type_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+static void lrng_proc_reseed_show_one(struct seq_file *m,
+				      struct lrng_drng *drng, bool pr, int node)
+{
+	unsigned long deadline = READ_ONCE(drng->reseed_deadline),
+		      now = jiffies;
+
+	seq_printf(m, "%s DRNG instance on NUMA node %d:\n"
+		   " Fully seeded: %s\n",
+		   pr ? "Prediction resistance" : "Regular", node,
+		   drng->fully_seeded ? "true" : "false");
+
+	/* The prediction resistance DRNG is reseeded for every request */
+	if (!pr) {
+		seq_printf(m,
+			   " Seconds until next time-based reseed: %lu\n"
+			   " Generate requests until reseed: %d\n",
+			   time_after(deadline, now) ? (deadline - now) / HZ : 0,
+			   max_t(int, atomic_read(&drng->requests), 0));
+	}
+
+	seq_printf(m,
+		   " Entropy harvests: %u\n"
+		   " Starved entropy harvests: %u\n"
+		   " Deferred entropy harvests: %u\n"
+		   " Seedings from root DRNG: %u\n",
+		   atomic_read(&drng->es_harvests),
+		   atomic_read(&drng->es_starvations),
+		   atomic_read(&drng->es_deferrals),
+		   atomic_read(&drng->seed_root_seedings));
+}
+
+static void lrng_proc_reseed_show_type(struct seq_file *m,
+				       struct lrng_drng **lrng_drng,
+				       struct lrng_drng *drng, bool pr)
+{
+	int node;
+
+	if (!lrng_drng) {
+		lrng_proc_reseed_show_one(m, drng, pr, 0);
+		return;
+	}
+
+	for_each_online_node(node) {
+		struct lrng_drng *node_drng = READ_ONCE(lrng_drng[node]);
+
+		if (node_drng)
+			lrng_proc_reseed_show_one(m, node_drng, pr, node);
+	}
+}
+
+/* Reseed schedule of the DRNGs seeded from the entropy sources */
+static int lrng_proc_reseed_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "LRNG entropy level: %u\n", lrng_avail_entropy());
+
+	lrng_proc_reseed_show_type(m, lrng_drng_instances(),
+				   lrng_drng_init_instance(), false);
+	lrng_proc_reseed_show_type(m, lrng_drng_pr_instances(),
+				   lrng_drng_pr_instance(), true);
+
+	return 0;
+}
+
 static int __init lrng_proc_type_init(void)
 {
 	proc_create_single("lrng_type", 0444, NULL, &lrng_proc_type_show);
+	proc_create_single("lrng_reseed", 0444, NULL, &lrng_proc_reseed_show);
 	return 0;
 }
 
@@ -8,8 +8,10 @@
 
 #ifdef CONFIG_SYSCTL
 void lrng_pool_inc_numa_node(void);
+void lrng_pool_dec_numa_node(void);
 #else
 static inline void lrng_pool_inc_numa_node(void) { }
+static inline void lrng_pool_dec_numa_node(void) { }
 #endif
 
 #endif /* _LRNG_PROC_H */
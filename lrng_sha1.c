@@ -68,7 +68,7 @@ static void lrng_sha1_hash_desc_zero(struct shash_desc *shash)
 	memzero_explicit(shash_desc_ctx(shash), sizeof(struct sha1_state));
 }
 
-static void *lrng_sha1_hash_alloc(void)
+static void *lrng_sha1_hash_alloc(int node)
 {
 	pr_info("Hash %s allocated\n", lrng_sha1_hash_name());
 	return NULL;
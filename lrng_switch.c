@@ -9,13 +9,16 @@
 
 #include <linux/lrng.h>
 
+#include "lrng_drng_bulk.h"
+#include "lrng_drng_percpu.h"
 #include "lrng_es_aux.h"
 #include "lrng_es_mgr.h"
 #include "lrng_interface_dev_common.h"
 #include "lrng_numa.h"
 
 static int __maybe_unused
-lrng_hash_switch(struct lrng_drng *drng_store, const void *cb, int node)
+lrng_hash_switch(struct lrng_drng *drng_store, const void *cb, int node,
+		 int alloc_node)
 {
 	const struct lrng_hash_cb *new_cb = (const struct lrng_hash_cb *)cb;
 	const struct lrng_hash_cb *old_cb = drng_store->hash_cb;
@@ -27,7 +30,7 @@ lrng_hash_switch(struct lrng_drng *drng_store, const void *cb, int node)
 	if (node == -1)
 		return 0;
 
-	new_hash = new_cb->hash_alloc();
+	new_hash = new_cb->hash_alloc(alloc_node);
 	old_hash = drng_store->hash;
 
 	if (IS_ERR(new_hash)) {
@@ -78,13 +81,16 @@ err:
 }
 
 static int __maybe_unused
-lrng_drng_switch(struct lrng_drng *drng_store, const void *cb, int node)
+lrng_drng_switch(struct lrng_drng *drng_store, const void *cb, int node,
+		 int alloc_node)
 {
 	const struct lrng_drng_cb *new_cb = (const struct lrng_drng_cb *)cb;
 	const struct lrng_drng_cb *old_cb = drng_store->drng_cb;
+	unsigned long flags;
 	int ret;
 	u8 seed[LRNG_DRNG_SECURITY_STRENGTH_BYTES];
-	void *new_drng = new_cb->drng_alloc(LRNG_DRNG_SECURITY_STRENGTH_BYTES);
+	void *new_drng = new_cb->drng_alloc(LRNG_DRNG_SECURITY_STRENGTH_BYTES,
+					    alloc_node);
 	void *old_drng = drng_store->drng;
 	u32 current_security_strength;
 	bool reset_drng = !lrng_get_available();
@@ -105,7 +111,9 @@ lrng_drng_switch(struct lrng_drng *drng_store, const void *cb, int node)
 	 * seeding of the new DRNG shall only ensure that the new DRNG has the
 	 * same entropy as the old DRNG.
 	 */
+	lrng_drng_state_lock(drng_store, &flags);
 	ret = old_cb->drng_generate(old_drng, seed, sizeof(seed));
+	lrng_drng_state_unlock(drng_store, &flags);
 	mutex_unlock(&drng_store->lock);
 
 	if (ret < 0) {
@@ -128,11 +136,16 @@ lrng_drng_switch(struct lrng_drng *drng_store, const void *cb, int node)
 
 	mutex_lock(&drng_store->lock);
 
+	/*
+	 * Atomic callers check the DRNG type and the DRNG state while holding
+	 * the spin lock
+	 */
+	spin_lock_irqsave(&drng_store->spin_lock, flags);
 	if (reset_drng)
 		lrng_drng_reset(drng_store);
-
 	drng_store->drng = new_drng;
 	drng_store->drng_cb = new_cb;
+	spin_unlock_irqrestore(&drng_store->spin_lock, flags);
 
 	/* Reseed if previous LRNG security strength was insufficient */
 	if (current_security_strength < lrng_security_strength())
@@ -157,28 +170,74 @@ lrng_drng_switch(struct lrng_drng *drng_store, const void *cb, int node)
 /*
  * Switch the existing DRNG and hash instances with new using the new crypto
  * callbacks. The caller must hold the lrng_crypto_cb_update lock.
+ *
+ * The node argument of the switcher denotes the NUMA node of the hash - it is
+ * -1 for DRNGs without a hash. The new states are allocated on alloc_node,
+ * the NUMA node the DRNG instance serves.
  */
 static int lrng_switch(const void *cb,
 		       int (*switcher)(struct lrng_drng *drng_store,
-				       const void *cb, int node))
+				       const void *cb, int node,
+				       int alloc_node))
 {
 	struct lrng_drng **lrng_drng = lrng_drng_instances();
 	struct lrng_drng *lrng_drng_init = lrng_drng_init_instance();
 	struct lrng_drng *lrng_drng_pr = lrng_drng_pr_instance();
-	int ret = 0;
+	int cpu, node, ret = 0;
 
 	if (lrng_drng) {
-		u32 node;
-
 		for_each_online_node(node) {
 			if (lrng_drng[node])
-				ret |= switcher(lrng_drng[node], cb, node);
+				ret |= switcher(lrng_drng[node], cb, node,
+						node);
 		}
 	} else {
-		ret |= switcher(lrng_drng_init, cb, 0);
+		ret |= switcher(lrng_drng_init, cb, 0, NUMA_NO_NODE);
+	}
+
+	ret |= switcher(lrng_drng_pr, cb, -1, NUMA_NO_NODE);
+
+	/* Prediction resistance DRNGs do not have a hash */
+	lrng_drng = lrng_drng_pr_instances();
+	if (lrng_drng) {
+		for_each_online_node(node) {
+			if (lrng_drng[node] && lrng_drng[node] != lrng_drng_pr)
+				ret |= switcher(lrng_drng[node], cb, -1, node);
+		}
 	}
 
-	ret |= switcher(lrng_drng_pr, cb, -1);
+	/* DRNGs retained for offline NUMA nodes are kept in sync */
+	lrng_drng = lrng_drng_offline_instances();
+	if (lrng_drng) {
+		for_each_node(node) {
+			if (lrng_drng[node])
+				ret |= switcher(lrng_drng[node], cb, node,
+						node);
+		}
+	}
+
+	lrng_drng = lrng_drng_pr_offline_instances();
+	if (lrng_drng) {
+		for_each_node(node) {
+			if (lrng_drng[node])
+				ret |= switcher(lrng_drng[node], cb, -1, node);
+		}
+	}
+
+	/* Per-CPU DRNGs do not have a hash, thus they are not node-bound */
+	for_each_possible_cpu(cpu) {
+		struct lrng_drng *drng = lrng_drng_percpu_instance(cpu);
+
+		if (drng)
+			ret |= switcher(drng, cb, -1, cpu_to_node(cpu));
+	}
+
+	for_each_node(node) {
+		struct lrng_drng *drng = lrng_drng_bulk_instance(node);
+
+		if (drng)
+			ret |= switcher(drng, cb, -1, node);
+	}
 
 	return ret;
 }
@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/*
+ * LRNG tracepoints
+ *
+ * Copyright (C) 2022, Stephan Mueller <smueller@chronox.de>
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lrng
+
+#if !defined(_LRNG_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LRNG_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/version.h>
+
+/*
+ * As of Linux 6.10, __assign_str() only takes the name of the string field
+ * and copies the string given with __string(). The string fields of the LRNG
+ * tracepoints are named like the arguments they are filled from which allows
+ * the use of the older two-argument form with the same semantics.
+ */
+#ifndef lrng_trace_assign_str
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 10, 0)
+#define lrng_trace_assign_str(dst)	__assign_str(dst)
+#else
+#define lrng_trace_assign_str(dst)	__assign_str(dst, dst)
+#endif
+#endif
+
+/*
+ * The durations reported by the tracepoints are in nanoseconds. They are only
+ * measured while the respective tracepoint is enabled.
+ */
+
+/* Seeding of one entropy source */
+TRACE_EVENT(lrng_es_get_ent,
+	TP_PROTO(const char *es, u32 requested_bits, u32 collected_bits,
+		 u64 duration),
+
+	TP_ARGS(es, requested_bits, collected_bits, duration),
+
+	TP_STRUCT__entry(
+		__string(es, es)
+		__field(u32, requested_bits)
+		__field(u32, collected_bits)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		lrng_trace_assign_str(es);
+		__entry->requested_bits	= requested_bits;
+		__entry->collected_bits	= collected_bits;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("es=%s requested_bits=%u collected_bits=%u duration=%llu",
+		  __get_str(es), __entry->requested_bits,
+		  __entry->collected_bits, __entry->duration)
+);
+
+/* Injection of a seed into a DRNG */
+TRACE_EVENT(lrng_drng_inject,
+	TP_PROTO(const void *drng, const char *drng_type, u32 inbuflen,
+		 bool fully_seeded, int ret, u64 duration),
+
+	TP_ARGS(drng, drng_type, inbuflen, fully_seeded, ret, duration),
+
+	TP_STRUCT__entry(
+		__field(const void *, drng)
+		__string(drng_type, drng_type)
+		__field(u32, inbuflen)
+		__field(bool, fully_seeded)
+		__field(int, ret)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->drng		= drng;
+		lrng_trace_assign_str(drng_type);
+		__entry->inbuflen	= inbuflen;
+		__entry->fully_seeded	= fully_seeded;
+		__entry->ret		= ret;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("drng=%p type=%s inbuflen=%u fully_seeded=%d ret=%d duration=%llu",
+		  __entry->drng, __get_str(drng_type), __entry->inbuflen,
+		  __entry->fully_seeded, __entry->ret, __entry->duration)
+);
+
+/* Seeding of a DRNG from the entropy sources */
+TRACE_EVENT(lrng_drng_seed_es,
+	TP_PROTO(const void *drng, const char *drng_type, u32 requested_bits,
+		 u32 collected_bits, u32 iterations, bool fully_seeded,
+		 u64 duration),
+
+	TP_ARGS(drng, drng_type, requested_bits, collected_bits, iterations,
+		fully_seeded, duration),
+
+	TP_STRUCT__entry(
+		__field(const void *, drng)
+		__string(drng_type, drng_type)
+		__field(u32, requested_bits)
+		__field(u32, collected_bits)
+		__field(u32, iterations)
+		__field(bool, fully_seeded)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->drng		= drng;
+		lrng_trace_assign_str(drng_type);
+		__entry->requested_bits	= requested_bits;
+		__entry->collected_bits	= collected_bits;
+		__entry->iterations	= iterations;
+		__entry->fully_seeded	= fully_seeded;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("drng=%p type=%s requested_bits=%u collected_bits=%u iterations=%u fully_seeded=%d duration=%llu",
+		  __entry->drng, __get_str(drng_type), __entry->requested_bits,
+		  __entry->collected_bits, __entry->iterations,
+		  __entry->fully_seeded, __entry->duration)
+);
+
+/* Wait for new entropy between two passes of the emergency seeding */
+TRACE_EVENT(lrng_drng_seed_backoff,
+	TP_PROTO(const void *drng, const char *drng_type, u32 pass,
+		 u32 collected_bits, u64 duration),
+
+	TP_ARGS(drng, drng_type, pass, collected_bits, duration),
+
+	TP_STRUCT__entry(
+		__field(const void *, drng)
+		__string(drng_type, drng_type)
+		__field(u32, pass)
+		__field(u32, collected_bits)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->drng		= drng;
+		lrng_trace_assign_str(drng_type);
+		__entry->pass		= pass;
+		__entry->collected_bits	= collected_bits;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("drng=%p type=%s pass=%u collected_bits=%u duration=%llu",
+		  __entry->drng, __get_str(drng_type), __entry->pass,
+		  __entry->collected_bits, __entry->duration)
+);
+
+/*
+ * Reseed of a DRNG including the wait for the DRNG lock and the reseed of the
+ * atomic DRNG
+ */
+TRACE_EVENT(lrng_drng_seed,
+	TP_PROTO(const void *drng, int node, u64 lock_wait, u64 duration),
+
+	TP_ARGS(drng, node, lock_wait, duration),
+
+	TP_STRUCT__entry(
+		__field(const void *, drng)
+		__field(int, node)
+		__field(u64, lock_wait)
+		__field(u64, duration)
+	),
+
+	TP_fast_assign(
+		__entry->drng		= drng;
+		__entry->node		= node;
+		__entry->lock_wait	= lock_wait;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("drng=%p node=%d lock_wait=%llu duration=%llu",
+		  __entry->drng, __entry->node, __entry->lock_wait,
+		  __entry->duration)
+);
+
+#endif /* _LRNG_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE lrng_trace
+#include <trace/define_trace.h>
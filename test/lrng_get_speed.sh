@@ -106,6 +106,31 @@ chacha20_drng_speed()
 	measure_speed "ChaCha20 DRNG"
 }
 
+# Measure the DRNG of each NUMA node from the first CPU of the node
+numa_node_speed()
+{
+	local node
+	local cpu
+
+	if [ ! -x "$SPEED" ]; then
+		echo "NUMA node test requires $SPEED"
+		return
+	fi
+
+	for node in /sys/devices/system/node/node[0-9]*
+	do
+		[ -f "$node/cpulist" ] || continue
+		cpu=$(cut -d "," -f 1 "$node/cpulist" | cut -d "-" -f 1)
+		[ -n "$cpu" ] || continue
+
+		for i in 16 32 64 128 256 512 1024 4096
+		do
+			speed=$($SPEED -c $cpu -b $i | cut -d "|" -f 2)
+			echo -e "$(basename $node) CPU $cpu\t$i\t$speed"
+		done
+	done
+}
+
 CPU=$(cat /proc/cpuinfo  | grep "model name" | tail -n1 | cut -d":" -f2)
 
 if [ -f /proc/lrng_type ]
@@ -124,6 +149,7 @@ then
 	hash_drbg_speed
 	hmac_drbg_speed
 	chacha20_drng_speed
+	numa_node_speed
 else
 	echo "Upstream /dev/urandom Speed test on $CPU"
 	echo -e "DRNG name\tBlocksize\tSpeed"
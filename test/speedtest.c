@@ -19,7 +19,7 @@
 
 /*
  * Compile:
- * gcc -Wall -pedantic -Wextra -o speedtest speedtest.c
+ * gcc -Wall -pedantic -Wextra -o speedtest speedtest.c -lpthread
  */
 
 /*
@@ -27,10 +27,11 @@
  */
 #define USE_GLIBC_GETRANDOM
 
+#define _GNU_SOURCE
+
 #ifdef USE_GLIBC_GETRANDOM
 #include <sys/random.h>
 #else
-#define _GNU_SOURCE
 #include <unistd.h>
 #include <sys/syscall.h>
 #endif
@@ -38,15 +39,40 @@
 #include <errno.h>
 #include <getopt.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <sys/resource.h>
+
+#ifndef GRND_RANDOM
+#define GRND_RANDOM	0x0002
+#endif
+
+/* Maximum number of latency samples recorded per thread */
+#define LATENCY_SAMPLES	(1UL<<20)
 
 struct opts {
 	uint64_t exectime;
 	size_t buflen;
+	unsigned int threads;
+	int latency;
+	size_t bulklen;
+	volatile int bulk_stop;
+	unsigned int flags;
+};
+
+struct thread_data {
+	pthread_t thread;
+	struct opts *opts;
+	uint64_t bytes;
+	uint64_t totaltime;
+	uint64_t *latencies;
+	size_t nr_latencies;
+	int ret;
 };
 
 /*
@@ -123,23 +149,29 @@ static int print_status(struct opts *opts,
 
 	memset(byteseconds, 0, sizeof(byteseconds));
 	bytes2string(processed_bytes, totaltime, byteseconds, (VALLEN + 1));
+	if (opts->threads > 1)
+		printf("%4u threads | ", opts->threads);
 	printf("%8lu bytes | %*s/s | %12lu bytes |%12lu ns\n", opts->buflen,
 	       VALLEN, byteseconds, processed_bytes, totaltime);
 
 	return 0;
 }
 
-static int speedtest(struct opts *opts)
+static void *speedtest_thread(void *arg)
 {
+	struct thread_data *td = arg;
+	struct opts *opts = td->opts;
 	uint64_t testduration = 0;
 	uint64_t totaltime = 0;
 	uint64_t bytes = 0;
 	uint64_t nano = 1000000000;
 	uint8_t *buffer = malloc(opts->buflen);
-	int ret;
+	int ret = 0;
 
-	if (!buffer)
-		return -ENOMEM;
+	if (!buffer) {
+		td->ret = -ENOMEM;
+		return NULL;
+	}
 
 	testduration = nano * opts->exectime;
 
@@ -149,9 +181,10 @@ static int speedtest(struct opts *opts)
 
 		start_time(&start);
 #ifdef USE_GLIBC_GETRANDOM
-		ret = getrandom(buffer, opts->buflen, 0);
+		ret = getrandom(buffer, opts->buflen, opts->flags);
 #else
-		ret = syscall(__NR_getrandom, buffer, opts->buflen, 0);
+		ret = syscall(__NR_getrandom, buffer, opts->buflen,
+			      opts->flags);
 #endif
 		end_time(&end);
 		if (ret < 0) {
@@ -159,13 +192,193 @@ static int speedtest(struct opts *opts)
 			goto out;
 		}
 		totaltime += (ts2u64(&end) - ts2u64(&start));
-		bytes += opts->buflen;
-	}
+		/* GRND_RANDOM requests may return less data than requested */
+		bytes += ret;
 
-	ret = print_status(opts, bytes, totaltime);
+		if (td->latencies && td->nr_latencies < LATENCY_SAMPLES) {
+			td->latencies[td->nr_latencies] =
+				ts2u64(&end) - ts2u64(&start);
+			td->nr_latencies++;
+		}
+	}
 
 out:
 	free(buffer);
+	td->bytes = bytes;
+	td->totaltime = totaltime;
+	td->ret = (ret < 0) ? ret : 0;
+	return NULL;
+}
+
+/*
+ * Background reader requesting bulk data until the measurement completes to
+ * measure its impact on the measured requests.
+ */
+static void *bulk_thread(void *arg)
+{
+	struct opts *opts = arg;
+	uint8_t *buffer = malloc(opts->bulklen);
+
+	if (!buffer)
+		return NULL;
+
+	while (!opts->bulk_stop) {
+#ifdef USE_GLIBC_GETRANDOM
+		if (getrandom(buffer, opts->bulklen, 0) < 0)
+#else
+		if (syscall(__NR_getrandom, buffer, opts->bulklen, 0) < 0)
+#endif
+			break;
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+static int u64_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Print the latency percentiles of the individual getrandom calls of all
+ * threads.
+ */
+static int print_latency(struct thread_data *td, unsigned int threads)
+{
+	uint64_t *all;
+	size_t i, nr = 0;
+
+	for (i = 0; i < threads; i++)
+		nr += td[i].nr_latencies;
+	if (!nr)
+		return 0;
+
+	all = malloc(nr * sizeof(*all));
+	if (!all)
+		return -ENOMEM;
+
+	nr = 0;
+	for (i = 0; i < threads; i++) {
+		memcpy(all + nr, td[i].latencies,
+		       td[i].nr_latencies * sizeof(*all));
+		nr += td[i].nr_latencies;
+	}
+
+	qsort(all, nr, sizeof(*all), u64_cmp);
+
+	printf("latency (ns) | p50 %lu | p90 %lu | p99 %lu | p99.9 %lu | max %lu | %zu samples\n",
+	       all[nr * 50 / 100], all[nr * 90 / 100], all[nr * 99 / 100],
+	       all[nr * 999 / 1000], all[nr - 1], nr);
+
+	free(all);
+	return 0;
+}
+
+static uint64_t cputime(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage))
+		return 0;
+
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+		1000000000 +
+	       (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) *
+		1000;
+}
+
+/*
+ * Print the distribution of the generated bytes over the threads and the CPU
+ * time consumed by all threads to assess the fairness and the CPU consumption
+ * of concurrent blocking requests.
+ */
+static void print_fairness(struct thread_data *td, unsigned int threads,
+			   uint64_t cpu)
+{
+	uint64_t min = UINT64_MAX, max = 0;
+	unsigned int i;
+
+	for (i = 0; i < threads; i++) {
+		if (td[i].bytes < min)
+			min = td[i].bytes;
+		if (td[i].bytes > max)
+			max = td[i].bytes;
+	}
+
+	printf("fairness | min %lu bytes | max %lu bytes per thread | cpu time %lu ns\n",
+	       min, max, cpu);
+}
+
+/*
+ * Run the test with the requested number of threads concurrently. The
+ * reported rate is the sum of the bytes generated by all threads divided by
+ * the longest time any thread spent in getrandom.
+ */
+static int speedtest(struct opts *opts)
+{
+	struct thread_data *td = calloc(opts->threads, sizeof(*td));
+	pthread_t bulk;
+	uint64_t totaltime = 0;
+	uint64_t bytes = 0;
+	uint64_t cpu = cputime();
+	unsigned int i, started;
+	int ret = 0;
+
+	if (!td)
+		return -ENOMEM;
+
+	if (opts->bulklen) {
+		opts->bulk_stop = 0;
+		ret = -pthread_create(&bulk, NULL, bulk_thread, opts);
+		if (ret) {
+			free(td);
+			return ret;
+		}
+	}
+
+	for (started = 0; started < opts->threads; started++) {
+		td[started].opts = opts;
+		if (opts->latency) {
+			td[started].latencies = calloc(LATENCY_SAMPLES,
+						       sizeof(uint64_t));
+			if (!td[started].latencies) {
+				ret = -ENOMEM;
+				break;
+			}
+		}
+		ret = -pthread_create(&td[started].thread, NULL,
+				      speedtest_thread, &td[started]);
+		if (ret)
+			break;
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(td[i].thread, NULL);
+		if (td[i].ret)
+			ret = td[i].ret;
+		bytes += td[i].bytes;
+		if (td[i].totaltime > totaltime)
+			totaltime = td[i].totaltime;
+	}
+
+	if (opts->bulklen) {
+		opts->bulk_stop = 1;
+		pthread_join(bulk, NULL);
+	}
+
+	if (!ret)
+		ret = print_status(opts, bytes, totaltime);
+	if (!ret && opts->latency)
+		ret = print_latency(td, started);
+	if (!ret && (opts->flags & GRND_RANDOM))
+		print_fairness(td, started, cputime() - cpu);
+
+	for (i = 0; i < opts->threads; i++)
+		free(td[i].latencies);
+	free(td);
 	return ret;
 }
 
@@ -179,6 +392,10 @@ int main(int argc, char *argv[])
 
 	opts.exectime = 2;
 	opts.buflen = 4096;
+	opts.threads = 1;
+	opts.latency = 0;
+	opts.bulklen = 0;
+	opts.flags = 0;
 
 	while (1)
 	{
@@ -187,9 +404,14 @@ int main(int argc, char *argv[])
 		{
 			{"exectime", 1, 0, 'e'},
 			{"buflen", 1, 0, 'b'},
+			{"threads", 1, 0, 't'},
+			{"latency", 0, 0, 'l'},
+			{"bulk", 1, 0, 'B'},
+			{"random", 0, 0, 'r'},
+			{"cpu", 1, 0, 'c'},
 			{0, 0, 0, 0}
 		};
-		c = getopt_long(argc, argv, "e:b:", options, &opt_index);
+		c = getopt_long(argc, argv, "e:b:t:lB:rc:", options, &opt_index);
 		if(-1 == c)
 			break;
 		switch (c)
@@ -205,6 +427,39 @@ int main(int argc, char *argv[])
 				if (lens >= MAXLEN)
 					return -EINVAL;
 				break;
+			case 't':
+				opts.threads = strtoul(optarg, NULL, 10);
+				if (!opts.threads || opts.threads == UINT_MAX)
+					return -EINVAL;
+				break;
+			case 'l':
+				opts.latency = 1;
+				break;
+			case 'B':
+				opts.bulklen = strtoul(optarg, NULL, 10);
+				if (opts.bulklen == ULONG_MAX)
+					return -EINVAL;
+				break;
+			case 'r':
+				opts.flags |= GRND_RANDOM;
+				break;
+			case 'c':
+			{
+				/*
+				 * Bind all threads to the CPU, e.g. to measure
+				 * the DRNG of the NUMA node of the CPU.
+				 */
+				cpu_set_t set;
+				unsigned long cpu = strtoul(optarg, NULL, 10);
+
+				if (cpu >= CPU_SETSIZE)
+					return -EINVAL;
+				CPU_ZERO(&set);
+				CPU_SET(cpu, &set);
+				if (sched_setaffinity(0, sizeof(set), &set))
+					return -errno;
+				break;
+			}
 			default:
 				return -EINVAL;
 		}